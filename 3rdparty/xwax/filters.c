@@ -35,7 +35,7 @@ int ema(struct ema_filter *filter, const int x)
         return -EINVAL;
     }
 
-    int y = filter->alpha * x + (1 - filter->alpha) * filter->y_old;
+    int y = ema_step(filter->alpha, filter->y_old, x);
     filter->y_old = y;
 
     return y;
@@ -97,11 +97,8 @@ int rms(struct root_mean_square *filter, const int x)
         return -EINVAL;
     }
 
-    /* Compute squared value */
-    unsigned long long squared = (unsigned long long)x * (unsigned long long)x;
-
     /* Apply EMA filter to squared values */
-    filter->squared_old = (1.0 - filter->alpha) * filter->squared_old + filter->alpha * squared;
+    filter->squared_old = rms_step(filter->alpha, filter->squared_old, x);
 
     /* Take square root at the end */
     return (int)sqrt(filter->squared_old);
@@ -7,6 +7,23 @@ struct ema_filter {
     int y_old;
 };
 
+/*
+ * One step of a filter whose state is held by the caller, so that a loop
+ * over a block can keep it in registers
+ */
+
+static inline int ema_step(double alpha, int y_old, int x)
+{
+    return alpha * x + (1 - alpha) * y_old;
+}
+
+static inline unsigned long long rms_step(float alpha, unsigned long long squared_old, int x)
+{
+    unsigned long long squared = (unsigned long long)x * (unsigned long long)x;
+
+    return (1.0 - alpha) * squared_old + alpha * squared;
+}
+
 void ema_init(struct ema_filter *, const double alpha);
 int ema(struct ema_filter *, const int x);
 
@@ -21,47 +21,57 @@
 #include <stdlib.h>
 
 #include "lut.h"
+#include "lut_cache.h"
 
-/* The number of bits to form the hash, which governs the overall size
- * of the hash lookup table, and hence the amount of chaining */
+/* Bucket of a timecode; multiplicative hashing spreads the LFSR
+ * values, which only differ by a shift and a bit, across the table */
 
-#define HASH_BITS 16
+static inline slot_no_t bucket(const struct lut *lut, bits_t timecode)
+{
+    unsigned int h = timecode * 0x9e3779b1u;
+    return (h ^ (h >> 16)) & lut->mask;
+}
 
-#define HASH(timecode) ((timecode) & ((1 << HASH_BITS) - 1))
-#define NO_SLOT ((slot_no_t)-1)
+/* Number of buckets to store the given number of slots: the smallest
+ * power of two which keeps the load factor under 3/4 */
+
+unsigned int lut_buckets(unsigned int nslots)
+{
+    unsigned int n = 1;
 
+    while (n - n / 4 < nslots)
+        n <<= 1;
+
+    return n;
+}
 
 /* Initialise an empty hash lookup table to store the given number
  * of timecode -> position lookups */
 
 int lut_init(struct lut *lut, int nslots)
 {
-    int n, hashes;
+    unsigned int n, buckets;
     size_t bytes;
 
-    hashes = 1 << HASH_BITS;
-    bytes = sizeof(struct slot) * nslots + sizeof(slot_no_t) * hashes;
-
-    fprintf(stderr, "Lookup table has %d hashes to %d slots"
-            " (%d slots per hash, %zuKb)\n",
-            hashes, nslots, nslots / hashes, bytes / 1024);
+    buckets = lut_buckets(nslots);
+    bytes = sizeof(struct lut_entry) * buckets;
 
-    lut->slot = (struct slot*)(malloc(sizeof(struct slot) * nslots));
-    if (lut->slot == NULL) {
-        perror("malloc");
-        return -1;
-    }
+    fprintf(stderr, "Lookup table has %u buckets for %d slots (%zuKb)\n",
+            buckets, nslots, bytes / 1024);
 
-    lut->table = (slot_no_t*)(malloc(sizeof(slot_no_t) * hashes));
+    lut->table = (struct lut_entry*)(malloc(bytes));
     if (lut->table == NULL) {
         perror("malloc");
         return -1;
     }
 
-    for (n = 0; n < hashes; n++)
-        lut->table[n] = NO_SLOT;
+    for (n = 0; n < buckets; n++)
+        lut->table[n].slot = LUT_NO_SLOT;
 
+    lut->mask = buckets - 1;
     lut->avail = 0;
+    lut->map = NULL;
+    lut->map_size = 0;
 
     return 0;
 }
@@ -69,43 +79,42 @@ int lut_init(struct lut *lut, int nslots)
 
 void lut_clear(struct lut *lut)
 {
+    if (lut->map) {
+        lut_cache_unmap(lut->map, lut->map_size);
+        lut->map = NULL;
+        return;
+    }
+
     free(lut->table);
-    free(lut->slot);
 }
 
 
 void lut_push(struct lut *lut, bits_t timecode)
 {
-    unsigned int hash;
-    slot_no_t slot_no;
-    struct slot *slot;
-
-    slot_no = lut->avail++; /* take the next available slot */
+    slot_no_t n;
 
-    slot = &lut->slot[slot_no];
-    slot->timecode = timecode;
+    n = bucket(lut, timecode);
+    while (lut->table[n].slot != LUT_NO_SLOT)
+        n = (n + 1) & lut->mask;
 
-    hash = HASH(timecode);
-    slot->next = lut->table[hash];
-    lut->table[hash] = slot_no;
+    lut->table[n].timecode = timecode;
+    lut->table[n].slot = lut->avail++; /* take the next available slot */
 }
 
 
-slot_no_t lut_lookup(struct lut *lut, bits_t timecode)
+slot_no_t lut_lookup(const struct lut *lut, bits_t timecode)
 {
-    unsigned int hash;
-    slot_no_t slot_no;
-    struct slot *slot;
-
-    hash = HASH(timecode);
-    slot_no = lut->table[hash];
-
-    while (slot_no != NO_SLOT) {
-        slot = &lut->slot[slot_no];
-        if (slot->timecode == timecode)
-            return slot_no;
-        slot_no = slot->next;
+    const struct lut_entry *entry;
+    slot_no_t n;
+
+    n = bucket(lut, timecode);
+
+    for (;;) {
+        entry = &lut->table[n];
+        if (entry->slot == LUT_NO_SLOT)
+            return LUT_NO_SLOT;
+        if (entry->timecode == timecode)
+            return entry->slot;
+        n = (n + 1) & lut->mask;
     }
-
-    return (slot_no_t)-1;
 }
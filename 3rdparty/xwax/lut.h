@@ -20,26 +20,42 @@
 #ifndef LUT_H
 #define LUT_H
 
+#include <stddef.h>
+
 #include "types.h"
 
 typedef unsigned int slot_no_t;
 typedef unsigned int bits_t;
 
-struct slot {
+#define LUT_NO_SLOT ((slot_no_t)-1)
+
+/*
+ * The lookup table is an open-addressing hash table with linear
+ * probing. Each bucket holds the timecode next to its position, so a
+ * lookup usually touches a single cache line; the number of buckets is
+ * a power of two sized to the format, keeping the load factor under
+ * 3/4 and the probe sequences short.
+ */
+
+struct lut_entry {
     bits_t timecode;
-    slot_no_t next; /* next slot with the same hash */
+    slot_no_t slot; /* LUT_NO_SLOT if the bucket is empty */
 };
 
 struct lut {
-    struct slot *slot;
-    slot_no_t *table, /* hash -> slot lookup */
+    struct lut_entry *table;
+    slot_no_t mask, /* number of buckets - 1 */
         avail; /* next available slot */
+    void *map; /* if not NULL, table points into this read-only mapping */
+    size_t map_size;
 };
 
+unsigned int lut_buckets(unsigned int nslots);
+
 int lut_init(struct lut *lut, int nslots);
 void lut_clear(struct lut *lut);
 
 void lut_push(struct lut *lut, bits_t timecode);
-unsigned int lut_lookup(struct lut *lut, bits_t timecode);
+slot_no_t lut_lookup(const struct lut *lut, bits_t timecode);
 
 #endif
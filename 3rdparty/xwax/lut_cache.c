@@ -0,0 +1,305 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "lut_cache.h"
+#include "timecoder.h"
+
+/*
+ * Bump the version whenever the layout of the header, of the slots or of
+ * the hash table changes: files with another version are rebuilt.
+ */
+
+#define LUT_CACHE_MAGIC "XWAXLUT"
+#define LUT_CACHE_VERSION 2
+#define LUT_CACHE_ENDIAN 0x01020304u
+#define LUT_CACHE_ALIGN 64
+
+enum lut_cache_kind {
+    LUT_CACHE_PLAIN = 0,
+    LUT_CACHE_MK2 = 1,
+};
+
+struct lut_cache_header {
+    char magic[8];
+    uint32_t version, endian, header_size, kind;
+
+    /* Parameters of the definition the table was built from */
+
+    uint32_t bits, resolution, length, reserved;
+    uint64_t seed_high, seed_low, taps_high, taps_low;
+
+    /* Layout of the table */
+
+    uint32_t slot_size, entry_size, buckets, avail;
+    uint64_t slot_offset, table_offset, file_size;
+};
+
+static size_t align_up(size_t n)
+{
+    return (n + LUT_CACHE_ALIGN - 1) & ~(size_t)(LUT_CACHE_ALIGN - 1);
+}
+
+static int cache_path(char *path, size_t size, const struct timecode_def *def,
+                      const char *lut_dir_path, const char *suffix)
+{
+    int n = snprintf(path, size, "%s/%s.xwaxlut%s", lut_dir_path, def->name, suffix);
+    return (n < 0 || (size_t)n >= size) ? -1 : 0;
+}
+
+/*
+ * Fill in the header expected for the given definition
+ */
+
+static void make_header(struct lut_cache_header *h, const struct timecode_def *def)
+{
+    const bool mk2 = (def->flags & TRAKTOR_MK2) != 0;
+    /* Only the MK2 tables have a slot array next to the buckets */
+    const size_t slot_size = mk2 ? sizeof(mk2bits_t) : 0;
+    const size_t entry_size = mk2 ? sizeof(struct lut_mk2_entry) : sizeof(struct lut_entry);
+    const size_t buckets = lut_buckets(def->length);
+
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, LUT_CACHE_MAGIC, sizeof(LUT_CACHE_MAGIC));
+    h->version = LUT_CACHE_VERSION;
+    h->endian = LUT_CACHE_ENDIAN;
+    h->header_size = sizeof(*h);
+    h->kind = mk2 ? LUT_CACHE_MK2 : LUT_CACHE_PLAIN;
+
+    h->bits = def->bits;
+    h->resolution = def->resolution;
+    h->length = def->length;
+    if (mk2) {
+        h->seed_high = def->seed_mk2.high;
+        h->seed_low = def->seed_mk2.low;
+        h->taps_high = def->taps_mk2.high;
+        h->taps_low = def->taps_mk2.low;
+    } else {
+        h->seed_low = def->seed;
+        h->taps_low = def->taps;
+    }
+
+    h->slot_size = slot_size;
+    h->entry_size = entry_size;
+    h->buckets = buckets;
+    h->slot_offset = align_up(sizeof(*h));
+    h->table_offset = align_up(h->slot_offset + slot_size * def->length);
+    h->file_size = h->table_offset + entry_size * buckets;
+}
+
+/*
+ * Map a whole file read-only
+ *
+ * Return: pointer to the mapping, or NULL on error
+ */
+
+static void *map_file(const char *path, size_t *size)
+{
+#ifdef _WIN32
+    HANDLE file, mapping;
+    LARGE_INTEGER file_size;
+    void *map = NULL;
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            map = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping); /* the view keeps the mapping alive */
+        }
+    }
+    CloseHandle(file);
+
+    *size = (size_t)file_size.QuadPart;
+    return map;
+#else
+    struct stat st;
+    void *map;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return NULL;
+
+    if (fstat(fd, &st) == -1 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); /* the mapping keeps the file alive */
+
+    if (map == MAP_FAILED)
+        return NULL;
+
+    *size = st.st_size;
+    return map;
+#endif
+}
+
+void lut_cache_unmap(void *map, size_t size)
+{
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(map);
+#else
+    munmap(map, size);
+#endif
+}
+
+/*
+ * Load the lookup table of a definition from the cache directory
+ *
+ * Return: 0 if the table was loaded and def->lookup set, otherwise -1
+ */
+
+int lut_cache_load(struct timecode_def *def, const char *lut_dir_path)
+{
+    struct lut_cache_header expected;
+    const struct lut_cache_header *h;
+    char path[1024];
+    size_t size = 0;
+    char *map;
+
+    if (!def || !lut_dir_path)
+        return -1;
+
+    if (cache_path(path, sizeof(path), def, lut_dir_path, ""))
+        return -1;
+
+    map = (char*)map_file(path, &size);
+    if (!map) {
+        fprintf(stderr, "LUT for %s not found on disk\n", def->desc);
+        return -1;
+    }
+
+    /* The file must have been built from the same definition, with the
+     * same layout; its size guards against truncated writes */
+
+    make_header(&expected, def);
+    h = (const struct lut_cache_header*)map;
+    if (size < sizeof(*h) || size != expected.file_size
+        || memcmp(h, &expected, offsetof(struct lut_cache_header, avail)) != 0
+        || h->slot_offset != expected.slot_offset
+        || h->table_offset != expected.table_offset
+        || h->avail != def->length)
+    {
+        fprintf(stderr, "LUT for %s on disk is stale, ignoring it\n", def->desc);
+        lut_cache_unmap(map, size);
+        return -1;
+    }
+
+    if (def->flags & TRAKTOR_MK2) {
+        def->lut_mk2.slot = (mk2bits_t*)(map + h->slot_offset);
+        def->lut_mk2.table = (struct lut_mk2_entry*)(map + h->table_offset);
+        def->lut_mk2.mask = h->buckets - 1;
+        def->lut_mk2.avail = h->avail;
+        def->lut_mk2.map = map;
+        def->lut_mk2.map_size = size;
+    } else {
+        def->lut.table = (struct lut_entry*)(map + h->table_offset);
+        def->lut.mask = h->buckets - 1;
+        def->lut.avail = h->avail;
+        def->lut.map = map;
+        def->lut.map_size = size;
+    }
+
+    def->lookup = true;
+
+    fprintf(stderr, "Mapped LUT for %s from %s\n", def->desc, path);
+
+    return 0;
+}
+
+static int write_at(FILE *fp, uint64_t offset, const void *data, size_t size)
+{
+    if (fseek(fp, (long)offset, SEEK_SET) != 0)
+        return -1;
+    return fwrite(data, 1, size, fp) == size ? 0 : -1;
+}
+
+/*
+ * Store the lookup table of a definition in the cache directory
+ *
+ * The file is written under a temporary name then renamed, so that
+ * other processes never map a partially written table.
+ *
+ * Return: 0 on success, otherwise -1
+ */
+
+int lut_cache_store(struct timecode_def *def, const char *lut_dir_path)
+{
+    struct lut_cache_header h;
+    char path[1024], tmp_path[1024];
+    const void *slots, *table;
+    FILE *fp;
+    int r;
+
+    if (!def || !lut_dir_path || !def->lookup)
+        return -1;
+
+    if (cache_path(path, sizeof(path), def, lut_dir_path, "")
+        || cache_path(tmp_path, sizeof(tmp_path), def, lut_dir_path, ".tmp"))
+        return -1;
+
+    make_header(&h, def);
+
+    if (def->flags & TRAKTOR_MK2) {
+        h.avail = def->lut_mk2.avail;
+        slots = def->lut_mk2.slot;
+        table = def->lut_mk2.table;
+    } else {
+        h.avail = def->lut.avail;
+        slots = NULL;
+        table = def->lut.table;
+    }
+
+    fprintf(stderr, "Storing LUT at %s\n", path);
+    fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        perror("fopen");
+        return -1;
+    }
+
+    r = write_at(fp, 0, &h, sizeof(h));
+    if (!r && slots)
+        r = write_at(fp, h.slot_offset, slots, (size_t)h.slot_size * def->length);
+    if (!r)
+        r = write_at(fp, h.table_offset, table, (size_t)h.entry_size * h.buckets);
+
+    if (fclose(fp) != 0)
+        r = -1;
+
+    if (r) {
+        perror("fwrite");
+        remove(tmp_path);
+        return -1;
+    }
+
+#ifdef _WIN32
+    if (!MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING)) {
+#else
+    if (rename(tmp_path, path) != 0) {
+#endif
+        fprintf(stderr, "Couldn't move LUT to %s\n", path);
+        remove(tmp_path);
+        return -1;
+    }
+
+    return 0;
+}
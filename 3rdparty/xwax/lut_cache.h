@@ -0,0 +1,30 @@
+#ifndef LUT_CACHE_H
+
+#define LUT_CACHE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+struct timecode_def;
+
+/*
+ * On-disk cache for the timecode lookup tables
+ *
+ * Both plain and Traktor MK2 tables are stored in a versioned binary
+ * file, which is mapped read-only in memory when loading: processes
+ * sharing the cache directory also share the pages of the tables.
+ */
+
+int lut_cache_load(struct timecode_def *def, const char *lut_dir_path);
+int lut_cache_store(struct timecode_def *def, const char *lut_dir_path);
+
+void lut_cache_unmap(void *map, size_t size);
+
+#ifdef __cplusplus
+};
+#endif // __cplusplus
+
+#endif /* end of include guard LUT_CACHE_H */
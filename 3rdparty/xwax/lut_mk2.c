@@ -1,74 +1,74 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "lut_cache.h"
 #include "lut_mk2.h"
 
-/*
- * The number of bits to form the hash, which governs the overall size
- * of the hash lookup table, and hence the amount of chaining
- */
-
-#define HASH_BITS 16
-
-#define HASH(timecode) ((timecode) & ((1 << HASH_BITS) - 1))
-#define NO_SLOT ((slot_no_t)-1)
-
 /*
  * Hash function that takes all 110-bits of the MK2s into account
+ *
+ * The low bits select the bucket and the high bits form the tag.
  */
 
-unsigned short HASH110(mk2bits_t *value) {
-
-    /* Simple hash mixing using bit shifts and XORs */
-    unsigned short hash = (unsigned short)(value->low ^ (value->low >> 16) ^ (value->low >> 32) ^
-            (value->low >> 48));
-    hash ^= (unsigned short)(value->high ^ (value->high << 5) ^ (value->high >> 3));
+static inline uint64_t hash110(const mk2bits_t *value)
+{
+    uint64_t h = value->low ^ (value->high * 0x9e3779b97f4a7c15ull);
 
-    /* Final scrambling to improve distribution */
-    hash ^= (hash >> 7) ^ (hash << 9);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
 
-    return hash;
+    return h;
 }
 
 /*
- * Initialise an empty hash lookup table to store the given number * of timecode -> position
+ * Initialise an empty hash lookup table to store the given number of timecode -> position
  * lookups (Traktor MK2 version)
  */
 
 int lut_init_mk2(struct lut_mk2 *lut, int nslots)
 {
+    unsigned int n, buckets;
     size_t bytes;
-    int n, hashes;
 
-    hashes = 1 << HASH_BITS;
-    bytes = sizeof(struct slot_mk2) * nslots + sizeof(slot_no_t) * hashes;
+    buckets = lut_buckets(nslots);
+    bytes = sizeof(mk2bits_t) * nslots + sizeof(struct lut_mk2_entry) * buckets;
 
-    fprintf(stderr, "Lookup table has %d hashes to %d slots"
-            " (%d slots per hash, %zuKb)\n",
-            hashes, nslots, nslots / hashes, bytes / 1024);
+    fprintf(stderr, "Lookup table has %u buckets for %d slots (%zuKb)\n",
+            buckets, nslots, bytes / 1024);
 
-    lut->slot = malloc(sizeof(struct slot_mk2) * nslots);
+    lut->slot = (mk2bits_t*)(malloc(sizeof(mk2bits_t) * nslots));
     if (lut->slot == NULL) {
         perror("malloc");
         return -1;
     }
 
-    lut->table = malloc(sizeof(slot_no_t) * hashes);
+    lut->table = (struct lut_mk2_entry*)(malloc(sizeof(struct lut_mk2_entry) * buckets));
     if (lut->table == NULL) {
         perror("malloc");
+        free(lut->slot);
         return -1;
     }
 
-    for (n = 0; n < hashes; n++)
-        lut->table[n] = NO_SLOT;
+    for (n = 0; n < buckets; n++)
+        lut->table[n].slot = LUT_NO_SLOT;
 
+    lut->mask = buckets - 1;
     lut->avail = 0;
+    lut->map = NULL;
+    lut->map_size = 0;
 
     return 0;
 }
 
 void lut_clear_mk2(struct lut_mk2 *lut)
 {
+    if (lut->map) {
+        lut_cache_unmap(lut->map, lut->map_size);
+        lut->map = NULL;
+        return;
+    }
+
     free(lut->table);
     free(lut->slot);
 }
@@ -79,39 +79,42 @@ void lut_clear_mk2(struct lut_mk2 *lut)
 
 void lut_push_mk2(struct lut_mk2 *lut, mk2bits_t *timecode)
 {
-    unsigned int hash;
-    slot_no_t slot_no;
-    struct slot_mk2 *slot;
+    uint64_t h;
+    slot_no_t n, slot_no;
 
     slot_no = lut->avail++; /* take the next available slot */
+    lut->slot[slot_no] = *timecode;
 
-    slot = &lut->slot[slot_no];
-    slot->timecode = *timecode;
+    h = hash110(timecode);
+    n = h & lut->mask;
+    while (lut->table[n].slot != LUT_NO_SLOT)
+        n = (n + 1) & lut->mask;
 
-    hash = HASH110(timecode);
-    slot->next = lut->table[hash];
-    lut->table[hash] = slot_no;
+    lut->table[n].tag = (unsigned int)(h >> 32);
+    lut->table[n].slot = slot_no;
 }
 
 /*
  * Traktor MK2 version holding 110-bit integers as timecode
  */
 
-slot_no_t lut_lookup_mk2(struct lut_mk2 *lut, mk2bits_t *timecode)
+slot_no_t lut_lookup_mk2(const struct lut_mk2 *lut, const mk2bits_t *timecode)
 {
-    unsigned int hash;
-    slot_no_t slot_no;
-    struct slot_mk2 *slot;
-
-    hash = HASH110(timecode);
-    slot_no = lut->table[hash];
-
-    while (slot_no != NO_SLOT) {
-        slot = &lut->slot[slot_no];
-        if (u128_eq(slot->timecode, *timecode))
-            return slot_no;
-        slot_no = slot->next;
+    const struct lut_mk2_entry *entry;
+    unsigned int tag;
+    uint64_t h;
+    slot_no_t n;
+
+    h = hash110(timecode);
+    tag = (unsigned int)(h >> 32);
+    n = h & lut->mask;
+
+    for (;;) {
+        entry = &lut->table[n];
+        if (entry->slot == LUT_NO_SLOT)
+            return LUT_NO_SLOT;
+        if (entry->tag == tag && u128_eq(lut->slot[entry->slot], *timecode))
+            return entry->slot;
+        n = (n + 1) & lut->mask;
     }
-
-    return (slot_no_t)-1;
 }
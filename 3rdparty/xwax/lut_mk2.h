@@ -6,20 +6,30 @@
 
 typedef u128 mk2bits_t;
 
-struct slot_mk2 {
-    mk2bits_t timecode;
-    slot_no_t next; /* next slot with the same hash */
+/*
+ * Same open-addressing scheme as the plain table, but the 110-bit
+ * timecodes are too large to sit in the buckets: a bucket stores a
+ * 32-bit tag of the hash, and the timecode is only compared in the slot
+ * array when the tags match.
+ */
+
+struct lut_mk2_entry {
+    unsigned int tag;
+    slot_no_t slot; /* LUT_NO_SLOT if the bucket is empty */
 };
 
 struct lut_mk2 {
-    struct slot_mk2 *slot;
-    slot_no_t *table, /* hash -> slot lookup */
+    mk2bits_t *slot; /* timecode of each slot */
+    struct lut_mk2_entry *table;
+    slot_no_t mask, /* number of buckets - 1 */
         avail; /* next available slot */
+    void *map; /* if not NULL, slot and table point into this read-only mapping */
+    size_t map_size;
 };
 
 int lut_init_mk2(struct lut_mk2 *lut, int nslots);
 void lut_clear_mk2(struct lut_mk2 *lut);
 void lut_push_mk2(struct lut_mk2 *lut, mk2bits_t *timecode);
-slot_no_t lut_lookup_mk2(struct lut_mk2 *lut, mk2bits_t *timecode);
+slot_no_t lut_lookup_mk2(const struct lut_mk2 *lut, const mk2bits_t *timecode);
 
 #endif /* end of include guard LUT_MK2_H */
@@ -0,0 +1,158 @@
+/*
+ * Kalman filter pitch estimator with steady-state gains precomputed per rate
+ *
+ * This is the model, modes and switches of pitch_kalman.h: see there.
+ * That filter runs the covariance update on every sample, and its
+ * division is in the chain from one sample to the next. Here, the gain of
+ * each mode is the one its covariance converges to, worked out once for
+ * the sample interval in pitch_kalman_fast_init(): an update is then a
+ * prediction, the mode switch and two multiply-adds.
+ *
+ * The difference is in the transients: the pitch_kalman.h covariance takes
+ * minutes (millions of samples) to settle in the stable mode, with a
+ * larger gain until then.
+ *
+ * Steady state
+ *
+ *   With the Q of pitch_kalman.h for an interval T, and the a posteriori
+ *   gains alpha = K[x] and beta = T * K[v], the Riccati equation reduces
+ *   to the two relations
+ *
+ *     alpha^2 + alpha * beta + beta^2 / 6 - 2 * beta = 0
+ *     beta^2 = lambda^2 * (1 - alpha),   lambda^2 = q * T^3 / r
+ *
+ *   which have a single solution with beta in (0, 3 - sqrt(3)).
+ */
+
+#ifndef PITCH_KALMAN_FAST_H
+#define PITCH_KALMAN_FAST_H
+
+#include <math.h>
+
+#include "pitch_kalman.h"
+
+enum {
+    PITCH_KALMAN_STABLE,
+    PITCH_KALMAN_ADJUST,
+    PITCH_KALMAN_REACTIVE,
+    PITCH_KALMAN_SCRATCH,
+    PITCH_KALMAN_MODES
+};
+
+/* Steady-state gain of a mode, for one dt */
+
+struct pitch_kalman_gain {
+    double x, v;
+};
+
+struct pitch_kalman_fast {
+    double dt;
+
+    double x, v; /* Position and velocity */
+
+    double adjust_threshold, reactive_threshold, scratch_threshold;
+
+    struct pitch_kalman_gain gains[PITCH_KALMAN_MODES];
+};
+
+static inline double pitch_kalman_steady_alpha(double beta)
+{
+    return 0.5 * (sqrt(8.0 * beta - beta * beta / 3.0) - beta);
+}
+
+/*
+ * Solve for the steady-state gain of the coefficients at interval dt
+ *
+ * beta^2 - lambda^2 * (1 - alpha(beta)) increases with beta: this is a
+ * bisection, which is exact to the last bits of beta in this many steps.
+ */
+
+static inline struct pitch_kalman_gain pitch_kalman_steady_gain(struct kalman_coeffs c,
+                                                                double dt)
+{
+    const double lambda2 = c.Q * dt * dt * dt / c.R;
+    double lo = 0.0, hi = 3.0 - sqrt(3.0), beta;
+    struct pitch_kalman_gain k;
+    int i;
+
+    for (i = 0; i < 128; i++) {
+        beta = 0.5 * (lo + hi);
+        if (beta * beta < lambda2 * (1.0 - pitch_kalman_steady_alpha(beta)))
+            lo = beta;
+        else
+            hi = beta;
+    }
+
+    beta = 0.5 * (lo + hi);
+    k.x = pitch_kalman_steady_alpha(beta);
+    k.v = beta / dt;
+    return k;
+}
+
+/*
+ * Initialize the filter with the coefficients and thresholds of
+ * pitch_kalman_init()
+ *
+ * The thresholds must be in increasing order from adjust to scratch.
+ */
+
+static inline void pitch_kalman_fast_init(struct pitch_kalman_fast *p, double dt,
+                                          struct kalman_coeffs stable,
+                                          struct kalman_coeffs adjust,
+                                          struct kalman_coeffs reactive,
+                                          struct kalman_coeffs scratch,
+                                          double adjust_threshold,
+                                          double reactive_threshold,
+                                          double scratch_threshold)
+{
+    p->dt = dt;
+
+    p->x = 0.0;
+    p->v = 0.0;
+
+    p->adjust_threshold = adjust_threshold;
+    p->reactive_threshold = reactive_threshold;
+    p->scratch_threshold = scratch_threshold;
+
+    p->gains[PITCH_KALMAN_STABLE] = pitch_kalman_steady_gain(stable, dt);
+    p->gains[PITCH_KALMAN_ADJUST] = pitch_kalman_steady_gain(adjust, dt);
+    p->gains[PITCH_KALMAN_REACTIVE] = pitch_kalman_steady_gain(reactive, dt);
+    p->gains[PITCH_KALMAN_SCRATCH] = pitch_kalman_steady_gain(scratch, dt);
+}
+
+/*
+ * Feed one observation: in the last dt seconds, position moved by dx
+ */
+
+static inline void pitch_kalman_fast_update(struct pitch_kalman_fast *p, double dx)
+{
+    const struct pitch_kalman_gain *k;
+
+    const double x_pred = p->x + p->v * p->dt;
+    const double y = dx - x_pred; /* Innovation */
+    const double y_abs = fabs(y);
+
+    /* The switches of pitch_kalman_update(); they hardly ever change from
+     * one sample to the next, so these branches are well predicted */
+
+    if (fabs(p->v) < 5e-2) /* Ensure reactivity and quick decay after standstill */
+        k = &p->gains[PITCH_KALMAN_SCRATCH];
+    else if (y_abs > p->scratch_threshold)
+        k = &p->gains[PITCH_KALMAN_SCRATCH];
+    else if (y_abs > p->reactive_threshold)
+        k = &p->gains[PITCH_KALMAN_REACTIVE];
+    else if (y_abs > p->adjust_threshold)
+        k = &p->gains[PITCH_KALMAN_ADJUST];
+    else
+        k = &p->gains[PITCH_KALMAN_STABLE];
+
+    p->x = x_pred + k->x * y - dx; /* relative to previous */
+    p->v += k->v * y;
+}
+
+static inline double pitch_kalman_fast_current(const struct pitch_kalman_fast *p)
+{
+    return p->v;
+}
+
+#endif /* PITCH_KALMAN_FAST_H */
@@ -32,9 +32,16 @@
 
 #include "debug.h"
 #include "filters.h"
+#include "lut_cache.h"
 #include "timecoder.h"
 #include "timecoder_mk2.h"
 
+#ifdef _MSC_VER
+#define ALWAYS_INLINE __forceinline
+#else
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#endif
+
 #define ZERO_RC 0.001 /* time constant for zero/rumble filter */
 
 #define REF_PEAKS_AVG 48 /* in wave cycles */
@@ -45,18 +52,28 @@
 
 #define VALID_BITS 24
 
-#define MONITOR_DECAY_EVERY 512 /* in samples */
+/* The time without a reading after which the needle counts as lifted,
+ * about the time between two readings at 1/100th of the slowest
+ * resolution */
+
+#define LIFTED_TIME 0.1 /* seconds */
+
+/* Modes of the Kalman pitch filters, and the innovation which switches
+ * to each of them */
+
+#define KALMAN_STABLE KALMAN_COEFFS(1e-8, 10.0)
+#define KALMAN_ADJUST KALMAN_COEFFS(1e-4, 1e-1)
+#define KALMAN_REACTIVE KALMAN_COEFFS(1e-3, 1e-2)
+#define KALMAN_SCRATCH KALMAN_COEFFS(1e-1, 1e-4)
+
+#define KALMAN_ADJUST_THRESHOLD 6e-4
+#define KALMAN_REACTIVE_THRESHOLD 25e-4
+#define KALMAN_SCRATCH_THRESHOLD 40e-4
 
-#define SQ(x) ((x)*(x))
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(*x))
 
 /* Timecode definitions */
 
-#define SWITCH_PHASE 0x1 /* tone phase difference of 270 (not 90) degrees */
-#define SWITCH_PRIMARY 0x2 /* use left channel (not right) as primary */
-#define SWITCH_POLARITY 0x4 /* read bit values in negative (not positive) */
-#define TRAKTOR_MK2 0x8 /* use for Traktor MK2 timecode*/
-
 static struct timecode_def timecodes[] = {
     {
      .name = "serato_2a",
@@ -326,22 +343,22 @@ struct timecode_def* timecoder_find_definition(const char *name, const char *lut
             continue;
 
         if (!def->lookup) {
-            if (def->flags & TRAKTOR_MK2) {
-                if (!lut_load_mk2(def, lut_dir_path))
-                    return def;
+            if (!lut_cache_load(def, lut_dir_path))
+                return def;
 
+            if (def->flags & TRAKTOR_MK2) {
                 if (build_lookup_mk2(def) == -1)
                     return NULL;  /* error */
-
-                if (lut_store_mk2(def, lut_dir_path)) {
-                    timecoder_free_lookup();
-                    fprintf(stderr, "Couldn't store LUT on disk\n");
-                    return NULL;
-                }
             } else {
                 if (build_lookup(def) == -1)
                     return NULL;  /* error */
             }
+
+            /* The cache is only an optimisation: the table built in
+             * memory is usable even if it could not be stored */
+
+            if (lut_dir_path && lut_cache_store(def, lut_dir_path))
+                fprintf(stderr, "Couldn't store LUT on disk\n");
         }
         return def;
     }
@@ -349,6 +366,25 @@ struct timecode_def* timecoder_find_definition(const char *name, const char *lut
     return NULL;  /* not found */
 }
 
+/*
+ * Free the lookup table of a single definition
+ *
+ * The caller must ensure that no timecoder is using this definition.
+ */
+
+void timecoder_free_definition(struct timecode_def *def)
+{
+    if (!def->lookup)
+        return;
+
+    if (def->flags & TRAKTOR_MK2)
+        lut_clear_mk2(&def->lut_mk2);
+    else
+        lut_clear(&def->lut);
+
+    def->lookup = false;
+}
+
 /*
  * Free the timecoder lookup tables when they are no longer needed
  */
@@ -356,17 +392,8 @@ struct timecode_def* timecoder_find_definition(const char *name, const char *lut
 void timecoder_free_lookup(void) {
     unsigned int n;
 
-    for (n = 0; n < ARRAY_SIZE(timecodes); n++) {
-        struct timecode_def *def = &timecodes[n];
-
-        if (def->flags & TRAKTOR_MK2) {
-            if (def->lookup)
-                lut_clear_mk2(&def->lut_mk2);
-        } else {
-            if (def->lookup)
-                lut_clear(&def->lut);
-        }
-    }
+    for (n = 0; n < ARRAY_SIZE(timecodes); n++)
+        timecoder_free_definition(&timecodes[n]);
 }
 
 /*
@@ -379,6 +406,9 @@ void mk2_subcode_init(struct mk2_subcode *sc)
     sc->avg_reading = INT_MAX/2;
     sc->avg_slope = INT_MAX/2;
     sc->bit = U128_ZERO;
+    sc->bitstream = U128_ZERO;
+    sc->timecode = U128_ZERO;
+    sc->recent_bit_flip = false;
 
     delayline_init(&sc->readings);
 
@@ -419,6 +449,8 @@ static void init_channel(struct timecode_def *def, struct timecoder_channel *ch)
         init_mk2_channel(ch);
 }
 
+static void select_kernel(struct timecoder *tc);
+
 /*
  * Initialise a timecode decoder at the given reference speed
  *
@@ -426,7 +458,8 @@ static void init_channel(struct timecode_def *def, struct timecoder_channel *ch)
  */
 
 void timecoder_init(struct timecoder *tc, struct timecode_def *def,
-                    double speed, unsigned int sample_rate, bool phono, bool pitch_estimator)
+                    double speed, unsigned int sample_rate, bool phono,
+                    enum timecoder_pitch_filter pitch_filter)
 {
     assert(def != NULL);
 
@@ -450,25 +483,34 @@ void timecoder_init(struct timecoder *tc, struct timecode_def *def,
     init_channel(tc->def, &tc->primary);
     init_channel(tc->def, &tc->secondary);
 
-    tc->use_legacy_pitch_filter = pitch_estimator; /* Switch for pitch filter type */
+    assert(pitch_filter < TIMECODER_PITCH_FILTERS);
+    tc->pitch_filter = pitch_filter;
 
     tc->quadrant = 0;
     tc->last_quadrant = 0;
     tc->direction_changed = false;
 
-    if (tc->use_legacy_pitch_filter) {
+    switch (pitch_filter) {
+    case TIMECODER_PITCH_ALPHA_BETA:
         pitch_init(&tc->pitch, tc->dt);
-    } else {
-        pitch_kalman_init(&tc->pitch_kalman,
-                          tc->dt,
-                          KALMAN_COEFFS(1e-8, 10.0), /* stable mode */
-                          KALMAN_COEFFS(1e-4, 1e-1), /* adjust mode */
-                          KALMAN_COEFFS(1e-3, 1e-2), /* reactive mode */
-                          KALMAN_COEFFS(1e-1, 1e-4), /* scratch mode */
-                          6e-4, /* adjust threshold */
-                          25e-4, /* reactive threshold */
-                          40e-4, /* scratch threshold */
+        break;
+    case TIMECODER_PITCH_KALMAN_FAST:
+        pitch_kalman_fast_init(&tc->pitch_kalman_fast, tc->dt,
+                               KALMAN_STABLE, KALMAN_ADJUST,
+                               KALMAN_REACTIVE, KALMAN_SCRATCH,
+                               KALMAN_ADJUST_THRESHOLD,
+                               KALMAN_REACTIVE_THRESHOLD,
+                               KALMAN_SCRATCH_THRESHOLD);
+        break;
+    default:
+        pitch_kalman_init(&tc->pitch_kalman, tc->dt,
+                          KALMAN_STABLE, KALMAN_ADJUST,
+                          KALMAN_REACTIVE, KALMAN_SCRATCH,
+                          KALMAN_ADJUST_THRESHOLD,
+                          KALMAN_REACTIVE_THRESHOLD,
+                          KALMAN_SCRATCH_THRESHOLD,
                           false);
+        break;
     }
 
     tc->ref_level = INT_MAX;
@@ -477,11 +519,19 @@ void timecoder_init(struct timecoder *tc, struct timecode_def *def,
     tc->valid_counter = 0;
     tc->timecode_ticker = 0;
 
-    tc->mon = NULL;
+    tc->quality.history = 0;
+    tc->quality.readings = 0;
+    tc->quality.good = 0;
+    tc->lifted_ticks = LIFTED_TIME * sample_rate;
+
+    tc->scope = NULL;
+    select_kernel(tc);
 
     /* Compute the factor the scale up the derivative to the original level */
     tc->gain_compensation = 1.0 / (M_PI * tc->def->resolution / tc->sample_rate);
 
+    tc->mk2_bitstream = U128_ZERO;
+    tc->mk2_timecode = U128_ZERO;
     mk2_subcode_init(&tc->upper_bitstream);
     mk2_subcode_init(&tc->lower_bitstream);
 }
@@ -492,8 +542,6 @@ void timecoder_init(struct timecoder *tc, struct timecode_def *def,
 
 void timecoder_clear(struct timecoder *tc)
 {
-    assert(tc->mon == NULL);
-
     if (tc->def->flags & TRAKTOR_MK2) {
         delayline_init(&tc->primary.mk2.delayline);
         delayline_init(&tc->secondary.mk2.delayline);
@@ -503,46 +551,32 @@ void timecoder_clear(struct timecoder *tc)
 }
 
 /*
- * Initialise a raster display of the incoming audio
- *
- * The monitor (otherwise known as 'scope' in the interface) is an x-y
- * display of the post-calibrated incoming audio.
+ * Attach a scope to the decoder, or detach it with NULL
  *
- * Return: -1 if not enough memory could be allocated, otherwise 0
+ * The scope (otherwise known as 'monitor') is an x-y display of the
+ * post-calibrated incoming audio. Only decimated points are given out:
+ * drawing and decaying them is left to the reader, outside of the audio
+ * path.
  */
 
-int timecoder_monitor_init(struct timecoder *tc, int size)
+void timecoder_scope_attach(struct timecoder *tc, struct timecoder_scope *scope)
 {
-    assert(tc->mon == NULL);
-    tc->mon_size = size;
-    tc->mon = (unsigned char*)(malloc(SQ(tc->mon_size)));
-    if (tc->mon == NULL) {
-        perror("malloc");
-        return -1;
+    if (scope) {
+        if (scope->decimation == 0)
+            scope->decimation = 1;
+        scope->counter = 0;
     }
-    memset(tc->mon, 0, SQ(tc->mon_size));
-    tc->mon_counter = 0;
-    return 0;
-}
-
-/*
- * Clear the monitor on the given timecoder
- */
-
-void timecoder_monitor_clear(struct timecoder *tc)
-{
-    assert(tc->mon != NULL);
-    free(tc->mon);
-    tc->mon = NULL;
+    tc->scope = scope;
+    select_kernel(tc);
 }
 
 /*
  * Update channel information with axis-crossings
  */
 
-static void detect_zero_crossing(struct timecoder_channel *ch,
-                                 signed int v, double alpha,
-                                 signed int threshold)
+static inline void detect_zero_crossing(struct timecoder_channel *ch,
+                                        signed int v, double alpha,
+                                        signed int threshold)
 {
     ch->crossing_ticker++;
 
@@ -561,40 +595,41 @@ static void detect_zero_crossing(struct timecoder_channel *ch,
 }
 
 /*
- * Plot the given sample value in the x-y monitor
+ * Give out one point of the x-y scope every few samples
  */
 
-static inline void update_monitor(struct timecoder *tc, signed int x, signed int y)
+static inline void update_scope(struct timecoder *tc, signed int x, signed int y)
 {
-    int px, py, size, ref;
+    struct timecoder_scope *scope = tc->scope;
+    float unit;
 
-    if (!tc->mon)
+    if (++scope->counter < scope->decimation)
         return;
+    scope->counter = 0;
 
-    size = tc->mon_size;
-    ref = tc->ref_level;
-
-    /* Decay the pixels already in the montior */
-
-    if (++tc->mon_counter % MONITOR_DECAY_EVERY == 0) {
-        int p;
-
-        for (p = 0; p < SQ(size); p++) {
-            if (tc->mon[p])
-                tc->mon[p] = tc->mon[p] * 7 / 8;
-        }
-    }
-
-    assert(ref > 0);
+    if (scope->count >= scope->capacity)
+        return;
 
     /* ref_level is half the precision of signal level */
-    px = size / 2 + (long long)x * size / ref / 8;
-    py = size / 2 + (long long)y * size / ref / 8;
+    unit = 1.0f / (4.0f * (float)tc->ref_level);
+    scope->x[scope->count] = (float)x * unit;
+    scope->y[scope->count] = (float)y * unit;
+    scope->count++;
+}
 
-    if (px < 0 || px >= size || py < 0 || py >= size)
-        return;
+/*
+ * Add the outcome of the error check of a reading to the quality
+ */
+
+static inline void observe_quality(struct timecoder_quality *q, bool good)
+{
+    const bool leaving = q->readings == TIMECODER_QUALITY_READINGS
+        && (q->history >> (TIMECODER_QUALITY_READINGS - 1)) != 0;
 
-    tc->mon[py * size + px] = 0xff; /* white */
+    q->good += (unsigned int)good - (unsigned int)leaving;
+    q->history = (q->history << 1) | good;
+    if (q->readings < TIMECODER_QUALITY_READINGS)
+        q->readings++;
 }
 
 /*
@@ -659,12 +694,11 @@ static void process_bitstream(struct timecoder *tc, signed int m)
  * crossings. Hence we multiply this quantity by displacement in quadrants.
  */
 
-static double quantize_phase(struct timecoder *tc)
+static ALWAYS_INLINE double quantize_phase(struct timecoder *tc, const bool switch_phase)
 {
     unsigned diff = ((tc->quadrant - tc->last_quadrant) % 4);
-    static unsigned long long direction_change_counter = 0;
-    const unsigned int forwards_diff = (tc->def->flags & SWITCH_PHASE) ? 1 : 3;
-    const unsigned int backwards_diff = (tc->def->flags & SWITCH_PHASE) ? 3 : 1;
+    const unsigned int forwards_diff = switch_phase ? 1 : 3;
+    const unsigned int backwards_diff = switch_phase ? 3 : 1;
 
     /* Check for a displacement of four quadrants */
     if (diff == 0 && !tc->direction_changed) {
@@ -703,102 +737,266 @@ static void track_quadrature_phase(struct timecoder *tc, bool direction_changed)
 }
 
 /*
- * Process a single sample from the incoming audio
+ * Observe the displacement of the last sample with the pitch filter
+ */
+
+static ALWAYS_INLINE void observe_pitch(struct timecoder *tc,
+                                        const enum timecoder_pitch_filter filter,
+                                        double dx)
+{
+    switch (filter) {
+    case TIMECODER_PITCH_ALPHA_BETA:
+        pitch_dt_observation(&tc->pitch, dx);
+        break;
+    case TIMECODER_PITCH_KALMAN_FAST:
+        pitch_kalman_fast_update(&tc->pitch_kalman_fast, dx);
+        break;
+    default:
+        pitch_kalman_update(&tc->pitch_kalman, dx);
+        break;
+    }
+}
+
+/*
+ * Process a block of at most TIMECODER_BLOCK samples from the incoming audio
  *
  * The two input signals (primary and secondary) are in the full range
  * of a signed int; ie. 32-bit signed.
+ *
+ * The MK2 carrier filters only depend on the input, and are run over the
+ * whole block first. The zero crossings, the pitch and the bitstream
+ * depend on each other and are followed sample by sample.
+ *
+ * The format, the pitch filter and the scope are constants: this is only
+ * called from the kernels below, one for each combination, so that none
+ * of them is tested in the loop.
  */
 
-static void process_sample(struct timecoder *tc,
-			   signed int primary, signed int secondary)
+static ALWAYS_INLINE void process_block_body(struct timecoder *tc,
+                                             const signed int *primary,
+                                             const signed int *secondary,
+                                             size_t n,
+                                             const bool mk2,
+                                             const bool switch_phase,
+                                             const bool read_positive,
+                                             const enum timecoder_pitch_filter filter,
+                                             const bool scope)
 {
-    if (tc->def->flags & TRAKTOR_MK2) {
-        mk2_process_carrier(tc, primary, secondary);
+    struct mk2_carrier_block carrier;
+    const signed int *carrier_primary, *carrier_secondary;
+    const signed int *left, *right;
+    size_t i;
+
+    const signed int threshold = tc->threshold;
+    const double alpha = tc->zero_alpha;
 
-        detect_zero_crossing(&tc->primary, tc->primary.mk2.deriv_scaled, tc->zero_alpha,
-                tc->threshold);
-        detect_zero_crossing(&tc->secondary, tc->secondary.mk2.deriv_scaled, tc->zero_alpha,
-                tc->threshold);
+    assert(n <= TIMECODER_BLOCK);
 
+    if (tc->def->flags & SWITCH_PRIMARY) {
+        left = primary;
+        right = secondary;
     } else {
-        detect_zero_crossing(&tc->primary, primary, tc->zero_alpha, tc->threshold);
-        detect_zero_crossing(&tc->secondary, secondary, tc->zero_alpha, tc->threshold);
+        left = secondary;
+        right = primary;
     }
 
-    /* If an axis has been crossed, use the direction of the crossing
-     * to work out the direction of the vinyl */
+    if (mk2) {
+        mk2_process_carrier_block(tc, primary, secondary, n, &carrier);
+        carrier_primary = carrier.deriv_scaled[0];
+        carrier_secondary = carrier.deriv_scaled[1];
+    } else {
+        carrier_primary = primary;
+        carrier_secondary = secondary;
+    }
+
+    for (i = 0; i < n; i++) {
+        detect_zero_crossing(&tc->primary, carrier_primary[i], alpha, threshold);
+        detect_zero_crossing(&tc->secondary, carrier_secondary[i], alpha, threshold);
+
+        /* If an axis has been crossed, use the direction of the crossing
+         * to work out the direction of the vinyl */
+
+        if (tc->primary.swapped || tc->secondary.swapped) {
+            bool forwards;
+
+            if (tc->primary.swapped) {
+                forwards = (tc->primary.positive != tc->secondary.positive);
+            } else {
+                forwards = (tc->primary.positive == tc->secondary.positive);
+            }
+
+            if (switch_phase)
+                forwards = !forwards;
 
-    if (tc->primary.swapped || tc->secondary.swapped) {
-        bool forwards;
+            track_quadrature_phase(tc, forwards != tc->forwards);
 
-        if (tc->primary.swapped) {
-            forwards = (tc->primary.positive != tc->secondary.positive);
+            if (forwards != tc->forwards) { /* direction has changed */
+                tc->forwards = forwards;
+                tc->valid_counter = 0;
+            }
+        }
+
+        /*
+         * If any axis has been crossed, register movement using the pitch
+         * counters. This occurs four time per cycle of the sinusoid.
+         */
+
+        if (!tc->primary.swapped && !tc->secondary.swapped) {
+            observe_pitch(tc, filter, 0.0);
         } else {
-            forwards = (tc->primary.positive == tc->secondary.positive);
+            double dx;
+
+            /*
+             * Assumption: We usually advance by a quarter rotation,
+             * unless we skip zero crossings. In this case the new quadrature
+             * tracker calculates the correct displacement for the pitch filter.
+             */
+
+            dx = quantize_phase(tc, switch_phase);
+            if (!tc->forwards)
+                dx = -dx;
+
+            observe_pitch(tc, filter, dx);
         }
 
-        if (tc->def->flags & SWITCH_PHASE)
-	    forwards = !forwards;
+        /* If we have crossed the primary channel in the right polarity,
+         * it's time to read off a timecode 0 or 1 value */
+
+        if (mk2) {
+            if (tc->secondary.swapped)
+            {
+                tc->secondary.mk2.rms = carrier.rms[i];
+                tc->secondary.mk2.rms_deriv = carrier.rms_deriv[i];
+                tc->gain_compensation = carrier.gain_compensation[i];
+                mk2_process_timecode(tc, carrier.reading[i]);
+                observe_quality(&tc->quality, tc->valid_counter > 0);
+            }
+        } else {
+            if (tc->secondary.swapped && tc->primary.positive == read_positive)
+            {
+                signed int m;
+
+                /* scale to avoid clipping */
+                m = abs(primary[i] / 2 - tc->primary.zero / 2);
+                process_bitstream(tc, m);
+                observe_quality(&tc->quality, tc->valid_counter > 0);
+            }
+        }
+
+        tc->timecode_ticker++;
 
-        track_quadrature_phase(tc, forwards != tc->forwards);
+        if (scope) {
+            if (mk2) {
+                /*
+                 * Display the derivative in the monitor. Since the signal is not
+                 * a perfect ring on the x-y-plane, but jumps up and down a bit,
+                 * it looks to small in the scope. Therefore a multiplication by
+                 * two is necessary.
+                 */
 
-        if (forwards != tc->forwards) { /* direction has changed */
-            tc->forwards = forwards;
-            tc->valid_counter = 0;
+                update_scope(tc, carrier_primary[i] * 2, carrier_secondary[i] * 2);
+            } else {
+                update_scope(tc, left[i], right[i]);
+            }
         }
     }
 
-    /*
-     * If any axis has been crossed, register movement using the pitch
-     * counters. This occurs four time per cycle of the sinusoid.
-     */
-
-    if (!tc->primary.swapped && !tc->secondary.swapped) {
-        if (tc->use_legacy_pitch_filter)
-            pitch_dt_observation(&tc->pitch, 0.0);
-        else
-            pitch_kalman_update(&tc->pitch_kalman, 0.0);
-    } else {
-        double dx;
+    /* The bitstream decoder saw the carrier of the crossing samples;
+     * leave it as of the last sample */
 
-        /*
-         * Assumption: We usually advance by a quarter rotation,
-         * unless we skip zero crossings. In this case the new quadrature
-         * tracker calculates the correct displacement for the pitch filter.
-         */
+    if (mk2 && n > 0) {
+        tc->secondary.mk2.rms = carrier.rms[n - 1];
+        tc->secondary.mk2.rms_deriv = carrier.rms_deriv[n - 1];
+        tc->gain_compensation = carrier.gain_compensation[n - 1];
+    }
+}
 
-        dx = quantize_phase(tc);
-        if (!tc->forwards)
-            dx = -dx;
+/*
+ * Decoding kernels for each family of formats, pitch filter and scope
+ *
+ * The families are the combinations of SWITCH_PHASE and SWITCH_POLARITY,
+ * and Traktor MK2, whose definitions have neither. SWITCH_PRIMARY only
+ * routes the channels, once per block.
+ */
 
-        if (tc->use_legacy_pitch_filter)
-            pitch_dt_observation(&tc->pitch, dx);
-        else
-            pitch_kalman_update(&tc->pitch_kalman, dx);
+#define TIMECODER_KERNEL(name, mk2, phase, polarity, filter, scope) \
+    static void name(struct timecoder *tc, \
+                     const signed int *primary, const signed int *secondary, \
+                     size_t n) \
+    { \
+        process_block_body(tc, primary, secondary, n, \
+                           mk2, phase, !(polarity), filter, scope); \
     }
 
-    /* If we have crossed the primary channel in the right polarity,
-     * it's time to read off a timecode 0 or 1 value */
+#define TIMECODER_FAMILY(family, mk2, phase, polarity) \
+    TIMECODER_KERNEL(family##_kalman, mk2, phase, polarity, \
+                     TIMECODER_PITCH_KALMAN, false) \
+    TIMECODER_KERNEL(family##_kalman_scope, mk2, phase, polarity, \
+                     TIMECODER_PITCH_KALMAN, true) \
+    TIMECODER_KERNEL(family##_alpha_beta, mk2, phase, polarity, \
+                     TIMECODER_PITCH_ALPHA_BETA, false) \
+    TIMECODER_KERNEL(family##_alpha_beta_scope, mk2, phase, polarity, \
+                     TIMECODER_PITCH_ALPHA_BETA, true) \
+    TIMECODER_KERNEL(family##_fast, mk2, phase, polarity, \
+                     TIMECODER_PITCH_KALMAN_FAST, false) \
+    TIMECODER_KERNEL(family##_fast_scope, mk2, phase, polarity, \
+                     TIMECODER_PITCH_KALMAN_FAST, true)
+
+TIMECODER_FAMILY(kernel_plain, false, false, false)
+TIMECODER_FAMILY(kernel_phase, false, true, false)
+TIMECODER_FAMILY(kernel_polarity, false, false, true)
+TIMECODER_FAMILY(kernel_phase_polarity, false, true, true)
+TIMECODER_FAMILY(kernel_mk2, true, false, false)
+
+#define TIMECODER_KERNELS(family) \
+    { { family##_kalman, family##_kalman_scope }, \
+      { family##_alpha_beta, family##_alpha_beta_scope }, \
+      { family##_fast, family##_fast_scope } }
+
+/* Indexed by family, pitch filter and scope */
+
+static const timecoder_kernel kernels[5][TIMECODER_PITCH_FILTERS][2] = {
+    TIMECODER_KERNELS(kernel_plain),
+    TIMECODER_KERNELS(kernel_phase),
+    TIMECODER_KERNELS(kernel_polarity),
+    TIMECODER_KERNELS(kernel_phase_polarity),
+    TIMECODER_KERNELS(kernel_mk2),
+};
 
-    if (tc->def->flags & TRAKTOR_MK2) {
-        if (tc->secondary.swapped)
-        {
-            int reading = *delayline_at(&tc->secondary.mk2.delayline, 3);
-            mk2_process_timecode(tc, reading);
-        }
+/*
+ * Choose the kernel for the definition, pitch filter and scope in use
+ *
+ * This has to follow any change to one of them.
+ */
+
+static void select_kernel(struct timecoder *tc)
+{
+    const int flags = tc->def->flags;
+    unsigned int family;
+
+    if (flags & TRAKTOR_MK2) {
+        assert(!(flags & (SWITCH_PHASE | SWITCH_POLARITY)));
+        family = 4;
     } else {
-        if (tc->secondary.swapped &&
-           tc->primary.positive == ((tc->def->flags & SWITCH_POLARITY) == 0))
-        {
-            signed int m;
-
-            /* scale to avoid clipping */
-            m = abs(primary / 2 - tc->primary.zero / 2);
-            process_bitstream(tc, m);
-        }
+        family = ((flags & SWITCH_PHASE) ? 1 : 0) | ((flags & SWITCH_POLARITY) ? 2 : 0);
     }
 
-    tc->timecode_ticker++;
+    tc->kernel = kernels[family][tc->pitch_filter][tc->scope ? 1 : 0];
+}
+
+/*
+ * Route a block of left and right samples to the primary and secondary
+ * channels, and decode it
+ */
+
+static void submit_planar(struct timecoder *tc,
+                          const signed int *left, const signed int *right, size_t n)
+{
+    const bool swap = (tc->def->flags & SWITCH_PRIMARY) == 0;
+    const signed int *primary = swap ? right : left;
+    const signed int *secondary = swap ? left : right;
+
+    tc->kernel(tc, primary, secondary, n);
 }
 
 /*
@@ -829,8 +1027,12 @@ static struct timecode_def* next_definition(struct timecode_def *def)
 void timecoder_cycle_definition(struct timecoder *tc)
 {
     tc->def = next_definition(tc->def);
+    select_kernel(tc);
     tc->valid_counter = 0;
     tc->timecode_ticker = 0;
+    tc->quality.history = 0;
+    tc->quality.readings = 0;
+    tc->quality.good = 0;
 }
 
 /*
@@ -841,38 +1043,89 @@ void timecoder_cycle_definition(struct timecoder *tc)
 
 void timecoder_submit(struct timecoder *tc, signed short *pcm, size_t npcm)
 {
-    while (npcm--) {
-	signed int left, right, primary, secondary;
+    signed int left[TIMECODER_BLOCK], right[TIMECODER_BLOCK];
 
-        left = pcm[0] << 16;
-        right = pcm[1] << 16;
+    while (npcm) {
+        size_t n, i;
 
-        if (tc->def->flags & SWITCH_PRIMARY) {
-            primary = left;
-            secondary = right;
-        } else {
-            primary = right;
-            secondary = left;
+        n = npcm < TIMECODER_BLOCK ? npcm : TIMECODER_BLOCK;
+
+        for (i = 0; i < n; i++) {
+            left[i] = pcm[i * TIMECODER_CHANNELS] << 16;
+            right[i] = pcm[i * TIMECODER_CHANNELS + 1] << 16;
         }
 
-        if (tc->def->flags & TRAKTOR_MK2) {
-            process_sample(tc, primary, secondary);
+        submit_planar(tc, left, right, n);
 
-            /* 
-             * Display the derivative in the monitor. Since the signal is not
-             * a perfect ring on the x-y-plane, but jumps up and down a bit,
-             * it looks to small in the scope. Therefore a multiplication by
-             * two is necessary.
-             */
+        pcm += n * TIMECODER_CHANNELS;
+        npcm -= n;
+    }
+}
 
-            update_monitor(tc, tc->primary.mk2.deriv_scaled * 2,
-                    tc->secondary.mk2.deriv_scaled * 2);
-        } else {
-            process_sample(tc, primary, secondary);
-            update_monitor(tc, left, right);
+/*
+ * Scale a floating-point sample to the level timecoder_submit() gives
+ * for 16-bit PCM, so that the thresholds of the definitions still apply
+ *
+ * Samples are in the range -1.0 to 1.0, and are clipped outside of it.
+ * This is branch-free, so that the loops calling it vectorise.
+ */
+
+static inline signed int scale_sample(double x)
+{
+    x = x < -1.0 ? -1.0 : (x > 1.0 ? 1.0 : x);
+    return (signed int)(x * (32767.0 * 65536.0));
+}
+
+/*
+ * Submit and decode planar floating-point audio to the timecode decoder
+ *
+ * Unlike 16-bit PCM, this keeps the full resolution of the signal, which
+ * matters at low needle levels.
+ */
+
+void timecoder_submit_block(struct timecoder *tc, const float *left, const float *right,
+                            size_t n)
+{
+    signed int l[TIMECODER_BLOCK], r[TIMECODER_BLOCK];
+
+    while (n) {
+        size_t len, i;
+
+        len = n < TIMECODER_BLOCK ? n : TIMECODER_BLOCK;
+
+        for (i = 0; i < len; i++) {
+            l[i] = scale_sample(left[i]);
+            r[i] = scale_sample(right[i]);
+        }
+
+        submit_planar(tc, l, r, len);
+
+        left += len;
+        right += len;
+        n -= len;
+    }
+}
+
+void timecoder_submit_double(struct timecoder *tc, const double *left, const double *right,
+                             size_t n)
+{
+    signed int l[TIMECODER_BLOCK], r[TIMECODER_BLOCK];
+
+    while (n) {
+        size_t len, i;
+
+        len = n < TIMECODER_BLOCK ? n : TIMECODER_BLOCK;
+
+        for (i = 0; i < len; i++) {
+            l[i] = scale_sample(left[i]);
+            r[i] = scale_sample(right[i]);
         }
 
-        pcm += TIMECODER_CHANNELS;
+        submit_planar(tc, l, r, len);
+
+        left += len;
+        right += len;
+        n -= len;
     }
 }
 
@@ -21,15 +21,25 @@
 #define TIMECODER_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "filters.h"
 #include "lut.h"
 #include "lut_mk2.h"
 #include "pitch.h"
 #include "pitch_kalman.h"
+#include "pitch_kalman_fast.h"
 #include "delayline.h"
 
 #define TIMECODER_CHANNELS 2
+#define TIMECODER_BLOCK 256 /* samples decoded per pass, bounds the stack use */
+
+/* Flags of the timecode definitions */
+
+#define SWITCH_PHASE 0x1 /* tone phase difference of 270 (not 90) degrees */
+#define SWITCH_PRIMARY 0x2 /* use left channel (not right) as primary */
+#define SWITCH_POLARITY 0x4 /* read bit values in negative (not positive) */
+#define TRAKTOR_MK2 0x8 /* use for Traktor MK2 timecode*/
 
 #ifdef __cplusplus
 extern "C" {
@@ -88,6 +98,62 @@ struct mk2_subcode {
     struct ema_filter ema_slope;
 };
 
+/*
+ * Decimated x-y points of the incoming audio, for a scope
+ *
+ * The buffers belong to the caller, which resets count before submitting
+ * audio and reads the points after. Points beyond the capacity are
+ * dropped. The coordinates are in the unit of the reference level: the
+ * signal is usually within [-1, 1].
+ */
+
+struct timecoder_scope {
+    float *x, *y;
+    unsigned int capacity, count;
+    unsigned int decimation, /* one point every this many samples */
+        counter;
+};
+
+/*
+ * Quality of the last readings of the bitstream
+ *
+ * One bit per reading, the most recent in the lowest bit, set if the
+ * reading passed the error check. The count of set bits follows the
+ * bits which enter and leave the history: an update is a few
+ * operations, at each reading rather than at each block, so the quality
+ * does not depend on the block size.
+ */
+
+#define TIMECODER_QUALITY_READINGS 64
+
+struct timecoder_quality {
+    uint64_t history;
+    unsigned int readings, /* in the history, up to TIMECODER_QUALITY_READINGS */
+        good; /* set bits of the history */
+};
+
+/*
+ * Filters for the pitch, estimated from the zero crossings
+ */
+
+enum timecoder_pitch_filter {
+    TIMECODER_PITCH_KALMAN,
+    TIMECODER_PITCH_ALPHA_BETA, /* the legacy filter */
+    TIMECODER_PITCH_KALMAN_FAST, /* the Kalman filter with steady-state gains */
+    TIMECODER_PITCH_FILTERS
+};
+
+/*
+ * Decoding loop over a block of the routed channels, chosen for the
+ * format, the pitch filter and the scope of the timecoder
+ */
+
+struct timecoder;
+typedef void (*timecoder_kernel)(struct timecoder *tc,
+                                 const signed int *primary,
+                                 const signed int *secondary,
+                                 size_t n);
+
 struct timecoder {
     struct timecode_def *def;
     double speed;
@@ -103,9 +169,10 @@ struct timecoder {
     bool forwards;
     struct timecoder_channel primary, secondary;
 
-    bool use_legacy_pitch_filter;
+    enum timecoder_pitch_filter pitch_filter;
     struct pitch pitch;
     struct pitch_kalman pitch_kalman;
+    struct pitch_kalman_fast pitch_kalman_fast;
     unsigned quadrant, last_quadrant;
     bool direction_changed;
 
@@ -119,28 +186,36 @@ struct timecoder {
     unsigned int valid_counter, /* number of successful error checks */
         timecode_ticker; /* samples since valid timecode was read */
     double dB; /* Decibels to detect phono level */
+    struct timecoder_quality quality;
+    unsigned int lifted_ticks; /* no reading for this many samples means lifted */
 
     /* Feedback */
 
-    unsigned char *mon; /* x-y array */
-    int mon_size, mon_counter;
+    struct timecoder_scope *scope; /* NULL if there is no scope */
+
+    timecoder_kernel kernel;
 
     struct mk2_subcode upper_bitstream, lower_bitstream;
     double gain_compensation; /* Scaling factor for the derivative */
 };
 
 struct timecode_def* timecoder_find_definition(const char *name, const char *lut_dir_path);
+void timecoder_free_definition(struct timecode_def *def);
 void timecoder_free_lookup(void);
 
 void timecoder_init(struct timecoder *tc, struct timecode_def *def,
-                    double speed, unsigned int sample_rate, bool phono, bool pitch_estimator);
+                    double speed, unsigned int sample_rate, bool phono,
+                    enum timecoder_pitch_filter pitch_filter);
 void timecoder_clear(struct timecoder *tc);
 
-int timecoder_monitor_init(struct timecoder *tc, int size);
-void timecoder_monitor_clear(struct timecoder *tc);
+void timecoder_scope_attach(struct timecoder *tc, struct timecoder_scope *scope);
 
 void timecoder_cycle_definition(struct timecoder *tc);
 void timecoder_submit(struct timecoder *tc, signed short *pcm, size_t npcm);
+void timecoder_submit_block(struct timecoder *tc, const float *left, const float *right,
+                            size_t n);
+void timecoder_submit_double(struct timecoder *tc, const double *left, const double *right,
+                             size_t n);
 signed int timecoder_get_position(struct timecoder *tc, double *when);
 
 /*
@@ -158,10 +233,43 @@ static inline struct timecode_def* timecoder_get_definition(struct timecoder *tc
 
 static inline double timecoder_get_pitch(struct timecoder *tc)
 {
-    if (tc->use_legacy_pitch_filter)
+    switch (tc->pitch_filter) {
+    case TIMECODER_PITCH_ALPHA_BETA:
         return pitch_current(&tc->pitch) / tc->speed;
-    else
+    case TIMECODER_PITCH_KALMAN_FAST:
+        return pitch_kalman_fast_current(&tc->pitch_kalman_fast) / tc->speed;
+    default:
         return pitch_kalman_current(&tc->pitch_kalman) / tc->speed;
+    }
+}
+
+/*
+ * Return the quality of the signal, from 0.0 (no timecode) to 1.0
+ *
+ * This is the share of good readings of the history, which has to fill
+ * up before reaching 1.0; it is 0.0 once the needle is lifted.
+ */
+
+static inline double timecoder_get_quality(struct timecoder *tc)
+{
+    if (tc->timecode_ticker > tc->lifted_ticks)
+        return 0.0;
+
+    return (double)tc->quality.good / TIMECODER_QUALITY_READINGS;
+}
+
+/*
+ * Return true if no timecode has been read lately: the needle is
+ * lifted, the record is stopped or the signal is not a timecode
+ *
+ * Either the last reading is too old, or none of the history is good.
+ */
+
+static inline bool timecoder_is_lifted(struct timecoder *tc)
+{
+    return tc->timecode_ticker > tc->lifted_ticks
+        || (tc->quality.readings == TIMECODER_QUALITY_READINGS
+            && tc->quality.good == 0);
 }
 
 /*
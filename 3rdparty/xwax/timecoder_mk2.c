@@ -121,165 +121,6 @@ int build_lookup_mk2(struct timecode_def *def)
     return 0;
 }
 
-/*
- * Caches the generated LUT on the disk.
- *
- * This is only necessary for the Traktor MK2, since the size of its hash
- * table is quite large.
- */
-
-int lut_store_mk2(struct timecode_def *def, const char *lut_dir_path)
-{
-    if (!def || !lut_dir_path)
-        return -1;
-
-    struct slot_mk2 *slot;
-    slot_no_t *hash;
-
-    int i, j, len, hashes;
-    char path[1024];
-    FILE *fp = NULL;
-    int r = 0;
-    int size;
-
-    sprintf(path, "%s/%s%s", lut_dir_path, def->name, ".lut");
-
-    fprintf(stdout, "Storing LUT at %s\n", path);
-    fp = fopen(path, "wb");
-    if (!fp) {
-        perror("fopen");
-        return -1;
-    }
-
-    for (i = 0; i < def->length; i++) {
-        slot = &def->lut_mk2.slot[i];
-
-        if (!slot) {
-            printf("slot_no: %d doesn't exist'\n", i);
-            r = -1;
-            goto out;
-        }
-        size = fwrite(slot, sizeof(struct slot_mk2), 1, fp);
-
-        if (!size) {
-            perror("fwrite");
-            r = -1;
-            goto out;
-        }
-    }
-
-    hashes = 1 << 16;
-    for (j = 0; j < hashes; j++) {
-        hash = &def->lut_mk2.table[j];
-
-        size = fwrite(hash, sizeof(slot_no_t), 1, fp);
-        if (!size) {
-            perror("fwrite");
-            r = -1;
-            goto out;
-        }
-    }
-
-    size = fwrite(&def->lut_mk2.avail, sizeof(slot_no_t), 1, fp);
-    if (!size) {
-        perror("fwrite");
-        r = -1;
-        goto out;
-    }
-
-out:
-    fclose(fp);
-
-    if (hashes != j || def->length != i)
-        fprintf(stderr, "Something went wrong: ");
-
-    fprintf(stderr, "Wrote %d hashes and %d slots to disk\n", j, i);
-
-    return r;
-}
-
-
-/*
- * Loads the stored LUT from the disk.
- *
- * This is only necessary for the Traktor MK2, since the size of its hash
- * table is quite large.
- */
-
-int lut_load_mk2(struct timecode_def *def, const char *lut_dir_path)
-{
-    if (!def || !lut_dir_path)
-        return -1;
-
-    struct slot_mk2 *slot;
-
-    char path[1024];
-    int i, j, hashes;
-    int r = 0;
-    int size;
-    FILE *fp;
-    int len;
-
-    sprintf(path, "%s/%s%s", lut_dir_path, def->name, ".lut");
-
-    fprintf(stdout, "Loading LUT from %s\n", path);
-    fp = fopen(path, "rb");
-    if (!fp) {
-        fprintf(stderr, "LUT for %s not found on disk\n", def->desc);
-        return -1;
-    }
-
-    r = lut_init_mk2(&def->lut_mk2, def->length);
-    if (r) {
-        fprintf(stderr, "Couldn't initialise LUT\n");
-        goto out;
-    }
-
-    fprintf(stdout, "Loading LUT from %s\n", path);
-    for (i = 0; i < def->length; i++) {
-        slot = &def->lut_mk2.slot[i];
-
-        size = fread(slot, sizeof(struct slot_mk2), 1, fp);
-        if (!size) {
-            perror("fread");
-            r = -1;
-            goto out;
-        }
-    }
-
-    hashes = 1 << 16;
-    for (j = 0; j < hashes; j++) {
-
-        slot_no_t *hash = &def->lut_mk2.table[j];
-
-        size = fread(hash, sizeof(slot_no_t), 1, fp);
-        if (!size) {
-            perror("fread");
-            r = -1;
-            goto out;
-        }
-    }
-
-    size = fread(&def->lut_mk2.avail, sizeof(slot_no_t), 1, fp);
-    if (!size) {
-        perror("fwrite");
-        r = -1;
-    }
-
-
-out:
-    fclose(fp);
-
-    if (hashes == j && def->length == i)
-        def->lookup = true;
-    else
-        fprintf(stderr, "Something went wrong: ");
-
-    fprintf(stderr, "Loaded %d hashes and %d slots from disk\n", j, i);
-
-    return r;
-}
-
 /*
  * Do Traktor-MK2-specific processing of the carrier wave
  *
@@ -294,46 +135,124 @@ out:
  * since it is easier to understand for developers not trained in signal
  * processing. Additionally it's nice to have the dB level at hand.
  *
+ * None of this depends on the decoded timecode, so it runs over a whole
+ * block of at most TIMECODER_BLOCK samples ahead of the bitstream
+ * decoder. The channel state is left as after the last sample.
  */
 
-void mk2_process_carrier(struct timecoder *tc, signed int primary, signed int secondary)
+void mk2_process_carrier_block(struct timecoder *tc,
+                               const signed int *primary, const signed int *secondary,
+                               size_t n, struct mk2_carrier_block *out)
 {
-    if (!tc) {
+    struct timecoder_channel_mk2 *p, *s;
+    int last_deriv[2] = {0, 0}, rms_primary = 0, rms_deriv_primary = 0;
+    size_t i;
+
+    if (!tc || !out) {
         errno = -EINVAL;
         perror(__func__);
         return;
     }
 
-    /* Push the samples into the ringbuffer */
-    delayline_push(&tc->primary.mk2.delayline, primary);
-    delayline_push(&tc->secondary.mk2.delayline, secondary);
+    assert(n <= TIMECODER_BLOCK);
+    if (n == 0)
+        return;
+
+    p = &tc->primary.mk2;
+    s = &tc->secondary.mk2;
 
-    /* Compute the discrete derivative */
-    tc->primary.mk2.deriv = derivative(&tc->primary.mk2.differentiator,
-            ema(&tc->primary.mk2.ema_filter, primary));
-    tc->secondary.mk2.deriv = derivative(&tc->secondary.mk2.differentiator,
-            ema(&tc->secondary.mk2.ema_filter, secondary));
+    /* The secondary carrier 3 samples ago; the first ones are still in
+     * the delayline */
 
-    /* Compute the smoothed RMS value */
-    tc->primary.mk2.rms = rms(&tc->primary.mk2.rms_filter, primary);
-    tc->secondary.mk2.rms = rms(&tc->secondary.mk2.rms_filter, secondary);
+    for (i = 0; i < n && i < 3; i++)
+        out->reading[i] = *delayline_at(&s->delayline, 2 - i);
+    for (; i < n; i++)
+        out->reading[i] = secondary[i - 3];
 
-    /* Compute the smoothed RMS value for the derivative */
-    tc->primary.mk2.rms_deriv = rms(&tc->primary.mk2.rms_deriv_filter, tc->primary.mk2.deriv);
-    tc->secondary.mk2.rms_deriv = rms(&tc->secondary.mk2.rms_deriv_filter, tc->secondary.mk2.deriv);
+    for (i = (n > DELAYLINE_SIZE) ? n - DELAYLINE_SIZE : 0; i < n; i++) {
+        delayline_push(&p->delayline, primary[i]);
+        delayline_push(&s->delayline, secondary[i]);
+    }
+
+    /* The filters are recursive: run them all in the same loop, so that
+     * their dependency chains overlap */
+
+    {
+        const double ema_alpha[2] = {p->ema_filter.alpha, s->ema_filter.alpha};
+        const float rms_alpha[2] = {p->rms_filter.alpha, s->rms_filter.alpha};
+        const float rms_deriv_alpha[2] = {p->rms_deriv_filter.alpha, s->rms_deriv_filter.alpha};
+
+        int ema_old[2] = {p->ema_filter.y_old, s->ema_filter.y_old};
+        int x_old[2] = {p->differentiator.x_old, s->differentiator.x_old};
+        unsigned long long squared[2] = {p->rms_filter.squared_old, s->rms_filter.squared_old};
+        unsigned long long squared_deriv[2] = {p->rms_deriv_filter.squared_old,
+                                               s->rms_deriv_filter.squared_old};
+
+        for (i = 0; i < n; i++) {
+            int deriv[2];
+            double gain;
+
+            /* Compute the discrete derivative */
+            ema_old[0] = ema_step(ema_alpha[0], ema_old[0], primary[i]);
+            ema_old[1] = ema_step(ema_alpha[1], ema_old[1], secondary[i]);
+            deriv[0] = ema_old[0] - x_old[0];
+            deriv[1] = ema_old[1] - x_old[1];
+            x_old[0] = ema_old[0];
+            x_old[1] = ema_old[1];
+
+            /* Compute the smoothed RMS value */
+            squared[0] = rms_step(rms_alpha[0], squared[0], primary[i]);
+            squared[1] = rms_step(rms_alpha[1], squared[1], secondary[i]);
+            out->rms[i] = (int)sqrt(squared[1]);
+
+            /* Compute the smoothed RMS value for the derivative */
+            squared_deriv[0] = rms_step(rms_deriv_alpha[0], squared_deriv[0], deriv[0]);
+            squared_deriv[1] = rms_step(rms_deriv_alpha[1], squared_deriv[1], deriv[1]);
+            out->rms_deriv[i] = (int)sqrt(squared_deriv[1]);
+
+            /* Compute the gain compensation for the derivative */
+            gain = (double)out->rms[i] / out->rms_deriv[i];
+
+            /* Without this limit pitch becomes too sensitive */
+            if (gain > 25.0)
+                gain = 25.0;
+
+            out->gain_compensation[i] = gain;
+
+            /* Compute the scaled derivative */
+            out->deriv_scaled[0][i] = deriv[0] * gain;
+            out->deriv_scaled[1][i] = deriv[1] * gain;
+
+            last_deriv[0] = deriv[0];
+            last_deriv[1] = deriv[1];
+        }
 
-    /* Compute the gain compensation for the derivative*/
-    tc->gain_compensation = (double)tc->secondary.mk2.rms / tc->secondary.mk2.rms_deriv;
+        p->ema_filter.y_old = ema_old[0];
+        s->ema_filter.y_old = ema_old[1];
+        p->differentiator.x_old = x_old[0];
+        s->differentiator.x_old = x_old[1];
+        p->rms_filter.squared_old = squared[0];
+        s->rms_filter.squared_old = squared[1];
+        p->rms_deriv_filter.squared_old = squared_deriv[0];
+        s->rms_deriv_filter.squared_old = squared_deriv[1];
 
-    /* Without this limit pitch becomes too sensitive */
-    if (tc->gain_compensation > 25.0)
-        tc->gain_compensation = 25.0;
+        /* Only read back from the channel: no need for them on every sample */
 
-    tc->dB = 20 * log10((double)tc->secondary.mk2.rms / INT_MAX);
+        rms_primary = (int)sqrt(squared[0]);
+        rms_deriv_primary = (int)sqrt(squared_deriv[0]);
+    }
 
-    /* Compute the scaled derivative */
-    tc->primary.mk2.deriv_scaled = tc->primary.mk2.deriv * tc->gain_compensation;
-    tc->secondary.mk2.deriv_scaled = tc->secondary.mk2.deriv * tc->gain_compensation;
+    p->deriv = last_deriv[0];
+    s->deriv = last_deriv[1];
+    p->rms = rms_primary;
+    s->rms = out->rms[n - 1];
+    p->rms_deriv = rms_deriv_primary;
+    s->rms_deriv = out->rms_deriv[n - 1];
+    p->deriv_scaled = out->deriv_scaled[0][n - 1];
+    s->deriv_scaled = out->deriv_scaled[1][n - 1];
+    tc->gain_compensation = out->gain_compensation[n - 1];
+
+    tc->dB = 20 * log10((double)s->rms / INT_MAX);
 }
 
 /*
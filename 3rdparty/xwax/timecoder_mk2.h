@@ -9,10 +9,24 @@ mk2bits_t fwd_mk2(mk2bits_t current, struct timecode_def *def);
 mk2bits_t rev_mk2(mk2bits_t current, struct timecode_def *def);
 
 int build_lookup_mk2(struct timecode_def *def);
-int lut_load_mk2(struct timecode_def *def, const char *lut_dir_path);
-int lut_store_mk2(struct timecode_def *def, const char *lut_dir_path);
 
-void mk2_process_carrier(struct timecoder *tc, signed int primary, signed int secondary);
+/*
+ * Per-sample results of the MK2 carrier processing, over one block
+ */
+
+struct mk2_carrier_block {
+    signed int deriv_scaled[2][TIMECODER_BLOCK]; /* primary, secondary */
+
+    /* Secondary channel, as read by mk2_process_timecode() */
+
+    int rms[TIMECODER_BLOCK], rms_deriv[TIMECODER_BLOCK];
+    double gain_compensation[TIMECODER_BLOCK];
+    signed int reading[TIMECODER_BLOCK]; /* carrier delayed by 3 samples */
+};
+
+void mk2_process_carrier_block(struct timecoder *tc,
+                               const signed int *primary, const signed int *secondary,
+                               size_t n, struct mk2_carrier_block *out);
 void mk2_process_timecode(struct timecoder *tc, signed int reading);
 
 #endif /* end of include guard TIMECODER_MK2_H */
@@ -1,6 +1,6 @@
 #include "LTC.hpp"
 
-#include <cassert>
+#include <algorithm>
 
 namespace ao
 {
@@ -8,77 +8,28 @@ namespace ao
 void LTCGenerator::prepare(halp::setup setup)
 {
   this->setup = setup;
-  update();
+
+  // All the allocations happen here: controls can then change during playback
+  m_encoder.prepare(setup.rate);
+
+  m_standard = inputs.rate;
+  m_encoder.reset(m_standard, smpte_from_seconds(0));
+  m_relocate = true;
 }
 
 void LTCGenerator::update()
 {
-  if(setup.rate <= 1)
-  {
-    if(m_encoder)
-    {
-      ltc_encoder_free(m_encoder);
-      m_encoder = nullptr;
-    }
-    return;
-  }
-
-  double fps = 30.;
-  switch(inputs.rate)
-  {
-    case LTC_TV_STANDARD::LTC_TV_525_60:
-    case LTC_TV_STANDARD::LTC_TV_1125_60:
-      fps = 30.;
-      break;
-    case LTC_TV_STANDARD::LTC_TV_625_50:
-      fps = 25.;
-      break;
-    case LTC_TV_STANDARD::LTC_TV_FILM_24:
-      fps = 24.;
-      break;
-  }
-
   if(!m_encoder)
-  {
-    m_encoder = ltc_encoder_create(setup.rate, fps, inputs.rate, 0);
-    assert(m_encoder);
-  }
-  else
-  {
-    ltc_encoder_reinit(m_encoder, setup.rate, fps, inputs.rate, 0);
-    assert(m_encoder);
-  }
+    return;
 
+  // Only a new frame rate needs the encoder to be reinitialised; the time is
+  // picked up from the transport on the next tick
+  if(inputs.rate != m_standard)
   {
-    auto cur_seconds = m_current_flicks / 705'600'000.;
-    auto smpte_offset = this->inputs.offset;
-    auto offset = int64_t(cur_seconds + smpte_offset);
-    const int days = std::div((long long)offset, (long long)86400).quot;
-    offset -= days * 86400;
-    const int hours = std::div((long long)offset, (long long)3600).quot;
-    offset -= hours * 3600;
-    const int minutes = std::div((long long)offset, (long long)60).quot;
-    offset -= minutes * 60;
-    const int seconds = offset;
-
-    SMPTETimecode st{
-        .timezone = "+0000",
-        .years = 0,
-        .months = 0,
-        .days = 0,
-        .hours = (uint8_t)hours,
-        .mins = (uint8_t)minutes,
-        .secs = (uint8_t)seconds,
-        .frame = 0};
-    ltc_encoder_set_timecode(m_encoder, &st);
+    m_standard = inputs.rate;
+    m_encoder.reset(m_standard, smpte_from_seconds(0));
   }
-
-  m_buffer = boost::circular_buffer<uint8_t>(ltc_encoder_get_buffersize(m_encoder) * 16);
-}
-
-LTCGenerator::~LTCGenerator()
-{
-  ltc_encoder_free(m_encoder);
+  m_relocate = true;
 }
 
 void LTCGenerator::operator()(halp::tick_flicks tk)
@@ -86,29 +37,43 @@ void LTCGenerator::operator()(halp::tick_flicks tk)
   if(!m_encoder)
     return;
 
-  m_current_flicks = tk.start_in_flicks;
-  // FIXME handle transport
-  // FIXME handle live framerate chagne
-  for(int frame = 0; frame < tk.frames; ++frame)
+  constexpr double flicks_per_second = 705'600'000.;
+
+  // The transport is followed when it moves: the speed is the one of the timeline,
+  // and the encoder is moved whenever it is not where the timeline is, e.g. after
+  // a seek or a loop. Otherwise the time code keeps running at the tempo.
+  const double fps = m_encoder.fps();
+  const double position = (tk.start_in_flicks / flicks_per_second + inputs.offset) * fps;
+  const auto duration = tk.end_in_flicks - tk.start_in_flicks;
+
+  double speed = 120. / tk.tempo;
+  bool relocate = m_relocate;
+  if(duration > 0)
   {
-    while(m_buffer.empty())
-    {
-      ltc_encoder_encode_byte(m_encoder, m_current_byte, 120. / tk.tempo);
-      if(++m_current_byte == 10)
-      {
-        ltc_encoder_inc_timecode(m_encoder);
-        m_current_byte = 0;
-      }
+    speed = tk.frames * flicks_per_second / (setup.rate * duration);
 
-      ltcsnd_sample_t* buf{};
-      int len = ltc_encoder_get_bufferptr(m_encoder, &buf, true);
-      for(int i = 0; i < len; i++)
-        m_buffer.push_back(buf[i]);
+    // Beyond a byte, the timeline jumped. Under it, the difference comes from the
+    // speed changing on byte boundaries and the rounding of the runs to samples:
+    // the encoder catches up along this tick instead of skipping.
+    const double drift = position - m_encoder.position();
+    const double samples_per_frame = setup.rate / fps * speed;
+    if(std::abs(drift) > 0.1)
+    {
+      relocate = true;
+    }
+    else if(std::abs(drift) * samples_per_frame > 1.)
+    {
+      const double frames = tk.frames / samples_per_frame + drift;
+      speed = std::clamp(tk.frames / (frames * setup.rate / fps), speed / 2., speed * 2.);
     }
+  }
 
-    ltcsnd_sample_t data = m_buffer.front();
-    m_buffer.pop_front();
-    outputs.audio[frame] = (data / 127.f) - 1.f;
+  if(relocate)
+  {
+    m_encoder.locate(position);
+    m_relocate = false;
   }
+
+  m_encoder.process(outputs.audio.channel, tk.frames, speed);
 }
 }
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <boost/circular_buffer.hpp>
+#include "LTCEncoder.hpp"
 
 #include <halp/audio.hpp>
 #include <halp/controls.hpp>
@@ -48,16 +48,15 @@ struct LTCGenerator
   void prepare(halp::setup setup);
   void update();
 
-  ~LTCGenerator();
   using tick = halp::tick_flicks;
   void operator()(halp::tick_flicks tk);
 
 private:
   halp::setup setup;
-  LTCEncoder* m_encoder{};
+  LTCBlockEncoder m_encoder;
+  LTC_TV_STANDARD m_standard{};
 
-  int m_current_byte = 0;
-  boost::circular_buffer<uint8_t> m_buffer;
-  int64_t m_current_flicks{};
+  // The controls changed: relocate on the next tick
+  bool m_relocate{true};
 };
 }
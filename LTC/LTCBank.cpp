@@ -0,0 +1,206 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "LTCBank.hpp"
+
+#include "LTCEncoder.hpp"
+
+#include <algorithm>
+#include <charconv>
+
+namespace ao
+{
+
+static constexpr LTC_TV_STANDARD group_standards[] = {
+    LTC_TV_STANDARD::LTC_TV_FILM_24,
+    LTC_TV_STANDARD::LTC_TV_625_50,
+    LTC_TV_STANDARD::LTC_TV_525_60,
+};
+
+static std::string_view trim(std::string_view s) noexcept
+{
+  while(!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+    s.remove_prefix(1);
+  while(!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+    s.remove_suffix(1);
+  return s;
+}
+
+// Parses "offset@fps" entries separated by commas or semicolons. Does not allocate.
+int LTCGeneratorBank::parse(
+    std::string_view spec, std::array<channel, max_channels>& out) noexcept
+{
+  int count = 0;
+  while(!spec.empty() && count < max_channels)
+  {
+    const auto sep = spec.find_first_of(",;");
+    const auto entry = trim(spec.substr(0, sep));
+    spec = sep == std::string_view::npos ? std::string_view{} : spec.substr(sep + 1);
+
+    auto& c = out[count++];
+    c = channel{};
+
+    const auto at = entry.find('@');
+    const auto offset = trim(entry.substr(0, at));
+    const auto fps = at == std::string_view::npos ? std::string_view{"30"}
+                                                   : trim(entry.substr(at + 1));
+
+    // Skip the sign ourselves: from_chars does not accept a leading '+'
+    auto first = offset.data();
+    if(!offset.empty() && offset.front() == '+')
+      ++first;
+    if(std::from_chars(first, offset.data() + offset.size(), c.offset).ec != std::errc{})
+      continue;
+
+    int rate = 0;
+    if(std::from_chars(fps.data(), fps.data() + fps.size(), rate).ec != std::errc{})
+      continue;
+
+    for(int g = 0; g < static_cast<int>(std::size(group_standards)); g++)
+      if(LTCBlockEncoder::fps(group_standards[g]) == rate)
+        c.group = g;
+  }
+  return count;
+}
+
+void LTCGeneratorBank::prepare(halp::setup setup)
+{
+  this->setup = setup;
+
+  for(int g = 0; g < static_cast<int>(m_groups.size()); g++)
+  {
+    m_groups[g].standard = group_standards[g];
+    m_groups[g].fps = LTCBlockEncoder::fps(group_standards[g]);
+  }
+
+  if(setup.rate > 1)
+  {
+    // Runs are at most a bit long, and the slowest bits are at 24 fps
+    m_biphase.prepare(
+        setup.rate, LTCBitClock::max_length(
+                        setup.rate, LTCBlockEncoder::fps(LTC_TV_STANDARD::LTC_TV_FILM_24),
+                        LTCBlockEncoder::max_speed));
+  }
+
+  update();
+}
+
+void LTCGeneratorBank::update()
+{
+  m_channel_count = parse(inputs.channels.value, m_channels);
+
+  for(auto& g : m_groups)
+  {
+    g.clock.reset(setup.rate, g.fps);
+    g.count = 0;
+  }
+
+  const auto cur_seconds = m_current_flicks / 705'600'000.;
+  for(int i = 0; i < m_channel_count; i++)
+  {
+    auto& c = m_channels[i];
+    if(c.group < 0)
+      continue;
+
+    auto& g = m_groups[c.group];
+    g.members[g.count++] = i;
+
+    auto st = smpte_from_seconds(int64_t(cur_seconds + c.offset));
+    ltc_time_to_frame(&c.frame, &st, g.standard, 0);
+  }
+}
+
+void LTCGeneratorBank::next_bit(group& g, double speed) noexcept
+{
+  const bool new_frame = g.clock.next(speed);
+
+  for(int m = 0; m < g.count; m++)
+  {
+    auto& c = m_channels[g.members[m]];
+    if(new_frame)
+      ltc_frame_increment(&c.frame, static_cast<int>(g.fps), g.standard, 0);
+
+    // Every bit starts with a transition. A 1 has another one in its middle,
+    // which brings back the level of its first run.
+    if(!c.one)
+      c.state = !c.state;
+    c.one = ltc_frame_bit(c.frame, g.clock.bit);
+  }
+}
+
+void LTCGeneratorBank::render(
+    const group& g, const channel& c, double* out, int count) const noexcept
+{
+  const auto& clk = g.clock;
+  const double level = c.state ? 1. : -1.;
+
+  if(!c.one)
+  {
+    m_biphase.run(out, clk.length, clk.pos, count, level);
+    return;
+  }
+
+  int done = 0;
+  if(clk.pos < clk.first_half)
+  {
+    done = std::min(count, clk.first_half - clk.pos);
+    m_biphase.run(out, clk.first_half, clk.pos, done, level);
+  }
+  if(done < count)
+  {
+    m_biphase.run(
+        out + done, clk.length - clk.first_half, clk.pos + done - clk.first_half,
+        count - done, -level);
+  }
+}
+
+void LTCGeneratorBank::operator()(halp::tick_flicks tk)
+{
+  const int frames = tk.frames;
+  const int channels = std::min(outputs.audio.channels, max_channels);
+  double** out = outputs.audio.samples;
+
+  m_current_flicks = tk.start_in_flicks;
+
+  for(int i = 0; i < outputs.audio.channels; i++)
+    if(i >= m_channel_count || m_channels[i].group < 0 || setup.rate <= 1)
+      std::fill_n(out[i], frames, 0.);
+
+  if(setup.rate <= 1)
+    return;
+
+  double speed = 120. / tk.tempo;
+  if(!(speed > 0.))
+    speed = 1.;
+  speed = std::min(speed, LTCBlockEncoder::max_speed);
+
+  for(auto& g : m_groups)
+  {
+    if(g.count == 0)
+      continue;
+
+    // Only go through the bits if a channel of this group is actually output
+    bool output = false;
+    for(int m = 0; m < g.count; m++)
+      output |= g.members[m] < channels;
+    if(!output)
+      continue;
+
+    for(int done = 0; done < frames;)
+    {
+      if(g.clock.pos == g.clock.length)
+        next_bit(g, speed);
+
+      const int n = std::min(frames - done, g.clock.length - g.clock.pos);
+      for(int m = 0; m < g.count; m++)
+      {
+        const int i = g.members[m];
+        if(i < channels)
+          render(g, m_channels[i], out[i] + done, n);
+      }
+
+      g.clock.pos += n;
+      done += n;
+    }
+  }
+}
+}
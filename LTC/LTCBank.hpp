@@ -0,0 +1,94 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "LTCBiphase.hpp"
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <ltc.h>
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace ao
+{
+/**
+ * @brief Several LTC feeds, each with its own offset and frame rate
+ *
+ * Channel i of the output follows entry i of the "Channels" list, written as
+ * `offset@fps` with fps one of 24, 25 or 30, e.g. `0@25, 3600@30, -10@24`.
+ * Channels without an entry are silent.
+ *
+ * The channels at the same frame rate share their bit timing, and the waveform of
+ * their runs: the per-channel cost is the copy of the samples with the polarity
+ * given by its own frame.
+ */
+struct LTCGeneratorBank
+{
+  halp_meta(name, "LTC Generator Bank")
+  halp_meta(author, "ossia team")
+  halp_meta(category, "Audio/Timing")
+  halp_meta(manual_url, "https://ossia.io/score-docs/processes/ltc-generator.html")
+  halp_meta(c_name, "avnd_ltc_gen_bank")
+  halp_meta(uuid, "7539c194-df73-4b1e-b718-1f5b9a597175")
+
+  static constexpr int max_channels = 64;
+
+  struct
+  {
+    struct : halp::lineedit<"Channels", "0@30">
+    {
+      void update(LTCGeneratorBank& self) { self.update(); }
+    } channels;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"LTC", double> audio;
+  } outputs;
+
+  void prepare(halp::setup setup);
+  void update();
+
+  using tick = halp::tick_flicks;
+  void operator()(halp::tick_flicks tk);
+
+private:
+  // One per frame rate
+  struct group
+  {
+    LTC_TV_STANDARD standard{};
+    double fps{};
+    LTCBitClock clock;
+
+    // Channels at this rate
+    std::array<int, max_channels> members{};
+    int count{};
+  };
+
+  struct channel
+  {
+    int group{-1}; // silent if < 0
+    int64_t offset{};
+    LTCFrame frame{};
+    bool state{}; // level of the first run of the current bit
+    bool one{};   // value of the current bit
+  };
+
+  static int parse(std::string_view spec, std::array<channel, max_channels>& out) noexcept;
+  void next_bit(group& g, double speed) noexcept;
+  void render(const group& g, const channel& c, double* out, int count) const noexcept;
+
+  halp::setup setup;
+  LTCBiphase m_biphase;
+  std::array<group, 3> m_groups{};
+  std::array<channel, max_channels> m_channels{};
+  int m_channel_count{};
+
+  int64_t m_current_flicks{};
+};
+}
@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "LTCBiphase.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ao
+{
+
+void LTCBiphase::prepare(double sample_rate, int max_run)
+{
+  // LTC should rise from 10% to 90% in 40 µs. A run starts from the centre, so it
+  // only takes half of that to reach its level.
+  const double rise_time = 20e-6;
+  const double k = 1. - std::exp(-1. / (sample_rate * rise_time / std::exp(1.)));
+
+  m_edge.resize(std::max(1, (max_run + 1) / 2));
+
+  double level = 0.;
+  for(auto& v : m_edge)
+  {
+    level += k * (amplitude - level);
+    v = level;
+  }
+}
+
+void LTCBiphase::run(
+    double* out, int n, int from, int count, double level) const noexcept
+{
+  const double* edge = m_edge.data();
+  const int rise = std::min((n + 1) / 2, static_cast<int>(m_edge.size()));
+
+  int i = from;
+  const int end = from + count;
+
+  // Rising part: a copy of the edge
+  for(const int stop = std::min(end, rise); i < stop; i++)
+    out[i - from] = level * edge[i];
+
+  // Flat part, for runs longer than the edge
+  for(const int stop = std::min(end, n - rise); i < stop; i++)
+    out[i - from] = level * edge[rise - 1];
+
+  // Falling part: the edge mirrored
+  for(; i < end; i++)
+    out[i - from] = level * edge[n - 1 - i];
+}
+
+void LTCRunTable::prepare(const LTCBiphase& shape, int min_run, int max_run)
+{
+  m_min = std::max(1, min_run);
+  m_max = std::max(m_min, max_run);
+  m_runs.assign(std::size_t(m_max - m_min + 1) * 2 * m_max, 0.);
+
+  for(int n = m_min; n <= m_max; n++)
+  {
+    shape.run(m_runs.data() + ((n - m_min) * 2 + 0) * m_max, n, 0, n, -1.);
+    shape.run(m_runs.data() + ((n - m_min) * 2 + 1) * m_max, n, 0, n, 1.);
+  }
+}
+
+void LTCBitClock::reset(double sample_rate, double fps) noexcept
+{
+  m_samples_per_bit = sample_rate / (fps * bits_per_frame);
+  m_remainder = 0.5;
+  bit = -1;
+  length = 0;
+  first_half = 0;
+  pos = 0;
+}
+
+bool LTCBitClock::next(double speed) noexcept
+{
+  const double per_bit = m_samples_per_bit * speed;
+
+  // Rounding the two halves of a 1 and the whole of a 0 ends up on the same
+  // sample: see libltc's encode_byte
+  first_half = static_cast<int>(per_bit / 2. + m_remainder);
+  length = static_cast<int>(per_bit + m_remainder);
+  m_remainder = per_bit + m_remainder - length;
+  pos = 0;
+
+  if(++bit == bits_per_frame)
+  {
+    bit = 0;
+    return true;
+  }
+  return false;
+}
+
+int LTCBitClock::max_length(double sample_rate, double fps, double speed) noexcept
+{
+  return static_cast<int>(std::ceil(sample_rate / (fps * bits_per_frame) * speed)) + 1;
+}
+}
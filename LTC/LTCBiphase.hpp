@@ -0,0 +1,101 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <ltc.h>
+
+#include <vector>
+
+namespace ao
+{
+/**
+ * @brief Biphase-mark waveform of LTC
+ *
+ * A bit is one run between two transitions for a 0, two runs for a 1. As in libltc,
+ * every run has the same shape: the level leaves the centre towards its target
+ * through a one-pole low-pass tuned for the SMPTE rise time, and comes back
+ * symmetrically at the end of the run. A run of n samples is thus the start of a
+ * single edge curve, mirrored: the curve is computed once in prepare() and the runs
+ * are copied out of it.
+ */
+class LTCBiphase
+{
+public:
+  // Level of the runs, -3 dBFS as libltc
+  static constexpr double amplitude = 0.70794578438413791;
+
+  // Allocates. max_run is the longest run that will be rendered, in samples.
+  void prepare(double sample_rate, int max_run);
+
+  // Writes the samples [from, from + count) of a run of n samples, with the sign
+  // of level
+  void run(double* out, int n, int from, int count, double level) const noexcept;
+
+private:
+  std::vector<double> m_edge;
+};
+
+/**
+ * @brief Whole runs of LTCBiphase, for a range of lengths
+ *
+ * At a constant speed the runs only take a few lengths: they are rendered once for
+ * both polarities, and a run is then a plain copy.
+ */
+class LTCRunTable
+{
+public:
+  // Allocates
+  void prepare(const LTCBiphase& shape, int min_run, int max_run);
+
+  bool contains(int n) const noexcept { return n >= m_min && n <= m_max; }
+
+  // Samples of a run of n samples, n in [min_run, max_run]
+  const double* run(int n, bool high) const noexcept
+  {
+    return m_runs.data() + ((n - m_min) * 2 + high) * m_max;
+  }
+
+private:
+  std::vector<double> m_runs;
+  int m_min{};
+  int m_max{};
+};
+
+/**
+ * @brief Sample timing of the LTC bits
+ *
+ * The length of a bit does not depend on its value, nor does the rounding remainder
+ * carried from one bit to the next: all the streams at one frame rate and speed can
+ * share it.
+ */
+class LTCBitClock
+{
+public:
+  static constexpr int bits_per_frame = 80;
+
+  void reset(double sample_rate, double fps) noexcept;
+
+  // Moves to the next bit, as long as the given speed. Returns true when it is the
+  // first bit of a new frame.
+  bool next(double speed) noexcept;
+
+  // Longest bit for this rate and speed, in samples
+  static int max_length(double sample_rate, double fps, double speed) noexcept;
+
+  int bit{-1};        // in the frame, 0 to 79
+  int length{};       // of the current bit, in samples
+  int first_half{};   // first run of the current bit if it is a 1, in samples
+  int pos{};          // samples of the current bit already output
+
+private:
+  double m_samples_per_bit{};
+  double m_remainder{0.5};
+};
+
+// Value of the given bit of a frame, in transmission order
+inline bool ltc_frame_bit(const LTCFrame& frame, int bit) noexcept
+{
+  const auto* bytes = reinterpret_cast<const unsigned char*>(&frame);
+  return (bytes[bit / 8] >> (bit % 8)) & 1;
+}
+}
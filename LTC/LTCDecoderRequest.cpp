@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "LTCDecoderRequest.hpp"
+
+namespace ao
+{
+
+LTCDecoderRequest::~LTCDecoderRequest()
+{
+  free_all();
+}
+
+void LTCDecoderRequest::free_all() noexcept
+{
+  if(m_pending)
+    ltc_decoder_free(m_pending);
+  if(m_current)
+    ltc_decoder_free(m_current);
+  m_pending = nullptr;
+  m_current = nullptr;
+  m_current_config = -1;
+}
+
+LTCDecoder* LTCDecoderRequest::reset(int apv, int queue_size)
+{
+  std::lock_guard lock{m_mutex};
+  free_all();
+
+  const int64_t cfg = config(apv, queue_size);
+  m_current = ltc_decoder_create(apv, queue_size);
+  m_current_config = m_current ? cfg : -1;
+
+  requested.store(cfg, std::memory_order_release);
+  published.store(m_current, std::memory_order_release);
+  in_use.store(m_current, std::memory_order_release);
+  return m_current;
+}
+
+void LTCDecoderRequest::process()
+{
+  std::lock_guard lock{m_mutex};
+
+  // The audio thread adopted the published decoder: the previous one can go
+  if(m_pending && in_use.load(std::memory_order_acquire) == m_pending)
+  {
+    if(m_current)
+      ltc_decoder_free(m_current);
+    m_current = m_pending;
+    m_pending = nullptr;
+  }
+
+  // Wait for the acknowledgement before publishing anything else
+  if(m_pending)
+    return;
+
+  const int64_t cfg = requested.load(std::memory_order_acquire);
+  if(cfg < 0 || cfg == m_current_config)
+    return;
+
+  m_current_config = cfg;
+  m_pending = ltc_decoder_create(int(cfg >> 32), int(cfg & 0xFFFFFFFF));
+  if(m_pending)
+    published.store(m_pending, std::memory_order_release);
+}
+}
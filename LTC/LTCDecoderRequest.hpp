@@ -0,0 +1,56 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <ltc.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace ao
+{
+/**
+ * @brief Hand-over of libltc decoders between the worker and the audio thread
+ *
+ * Creating and freeing a decoder allocates: when the settings change while
+ * running, the audio thread writes `requested` then wakes the Worker, which builds
+ * the decoder and publishes it in `published`. The audio thread adopts it and
+ * acknowledges through `in_use`; only then does the worker free the previous one.
+ *
+ * The audio thread only touches the atomics. reset() builds the decoder right away
+ * for prepare(), when the audio thread is not running.
+ */
+struct LTCDecoderRequest
+{
+  std::atomic<int64_t> requested{-1};
+  std::atomic<LTCDecoder*> published{nullptr};
+  std::atomic<LTCDecoder*> in_use{nullptr};
+
+  // Audio samples per frame and queue size, packed for `requested`
+  static constexpr int64_t config(int apv, int queue_size) noexcept
+  {
+    return (int64_t(apv) << 32) | uint32_t(queue_size);
+  }
+
+  LTCDecoderRequest() = default;
+  LTCDecoderRequest(const LTCDecoderRequest&) = delete;
+  LTCDecoderRequest& operator=(const LTCDecoderRequest&) = delete;
+  ~LTCDecoderRequest();
+
+  // Non real-time: replaces every decoder with a new one, which is returned
+  LTCDecoder* reset(int apv, int queue_size);
+
+  // Worker thread
+  void process();
+
+private:
+  void free_all() noexcept;
+
+  // Serialises reset() with the worker
+  std::mutex m_mutex;
+  LTCDecoder* m_current{};
+  LTCDecoder* m_pending{};
+  int64_t m_current_config{-1};
+};
+}
@@ -0,0 +1,368 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "LTCEncoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace ao
+{
+
+// Unsigned 8-bit libltc samples to [-1; 1], negated if needed. Kept trivial so that
+// it vectorises.
+static void convert_samples(
+    const ltcsnd_sample_t* in, double* out, int n, bool invert) noexcept
+{
+  const double scale = invert ? -1. / 127. : 1. / 127.;
+  const double offset = invert ? 1. : -1.;
+  for(int i = 0; i < n; i++)
+    out[i] = in[i] * scale + offset;
+}
+
+// Number of runs of a byte, modulo 2: each bit has one, plus one more for a 1
+static bool byte_parity(const LTCFrame& frame, int byte) noexcept
+{
+  unsigned v = reinterpret_cast<const unsigned char*>(&frame)[byte];
+  v ^= v >> 4;
+  v ^= v >> 2;
+  v ^= v >> 1;
+  return v & 1;
+}
+
+SMPTETimecode smpte_from_seconds(int64_t offset) noexcept
+{
+  const int days = std::div((long long)offset, (long long)86400).quot;
+  offset -= days * 86400;
+  const int hours = std::div((long long)offset, (long long)3600).quot;
+  offset -= hours * 3600;
+  const int minutes = std::div((long long)offset, (long long)60).quot;
+  offset -= minutes * 60;
+  const int seconds = offset;
+
+  return SMPTETimecode{
+      .timezone = "+0000",
+      .years = 0,
+      .months = 0,
+      .days = 0,
+      .hours = (uint8_t)hours,
+      .mins = (uint8_t)minutes,
+      .secs = (uint8_t)seconds,
+      .frame = 0};
+}
+
+SMPTETimecode smpte_from_frames(int64_t frames, int fps) noexcept
+{
+  const int64_t per_day = 86400 * int64_t(fps);
+  frames %= per_day;
+  if(frames < 0)
+    frames += per_day;
+
+  auto tc = smpte_from_seconds(frames / fps);
+  tc.frame = static_cast<uint8_t>(frames % fps);
+  return tc;
+}
+
+LTCBlockEncoder::~LTCBlockEncoder()
+{
+  if(m_encoder)
+    ltc_encoder_free(m_encoder);
+}
+
+double LTCBlockEncoder::fps(LTC_TV_STANDARD standard) noexcept
+{
+  switch(standard)
+  {
+    case LTC_TV_STANDARD::LTC_TV_525_60:
+    case LTC_TV_STANDARD::LTC_TV_1125_60:
+      return 30.;
+    case LTC_TV_STANDARD::LTC_TV_625_50:
+      return 25.;
+    case LTC_TV_STANDARD::LTC_TV_FILM_24:
+      return 24.;
+  }
+  return 30.;
+}
+
+void LTCBlockEncoder::prepare(double sample_rate)
+{
+  if(m_encoder)
+  {
+    ltc_encoder_free(m_encoder);
+    m_encoder = nullptr;
+  }
+
+  m_rate = sample_rate;
+  m_staged = nullptr;
+  m_staged_pos = 0;
+  m_staged_len = 0;
+  m_frame = 0;
+  m_current_byte = 0;
+  m_skip = 0.;
+  m_nominal = false;
+
+  if(sample_rate <= 1)
+    return;
+
+  // At the nominal speed, bits are between the samples per bit at 30 fps and at
+  // 24 fps, and each half of a 1 is within a sample of half of that
+  const int shortest = static_cast<int>(sample_rate / (fps(LTC_TV_525_60) * 80.) / 2.) - 1;
+  const int longest = LTCBitClock::max_length(sample_rate, fps(LTC_TV_FILM_24), 1.);
+  m_shape.prepare(sample_rate, longest);
+  m_runs.prepare(m_shape, shortest, longest);
+
+  // libltc sizes its buffer for one frame at the given frame rate, and
+  // ltc_encoder_reinit refuses anything larger: ask for the slowest case up front
+  m_encoder = ltc_encoder_create(
+      sample_rate, fps(LTC_TV_FILM_24) / max_speed, LTC_TV_FILM_24, 0);
+}
+
+void LTCBlockEncoder::reset(LTC_TV_STANDARD standard, const SMPTETimecode& tc) noexcept
+{
+  if(!m_encoder)
+    return;
+
+  m_fps = fps(standard);
+  m_standard = standard;
+  ltc_encoder_reinit(m_encoder, m_rate, m_fps, standard, 0);
+
+  auto st = tc;
+  ltc_encoder_set_timecode(m_encoder, &st);
+  ltc_time_to_frame(&m_ltc_frame, &st, m_standard, 0);
+  m_ltc_state = false;
+  m_invert = false;
+  m_nominal = false;
+  m_clock.reset(m_rate, m_fps);
+
+  m_staged = nullptr;
+  m_staged_pos = 0;
+  m_staged_len = 0;
+  m_frame = (tc.hours * 3600 + tc.mins * 60 + tc.secs) * int64_t(m_fps) + tc.frame;
+  m_current_byte = 0;
+  m_skip = 0.;
+}
+
+void LTCBlockEncoder::locate(double position) noexcept
+{
+  if(!m_encoder)
+    return;
+
+  // Only the frame changes: the encoder keeps its rate, polarity and remainder,
+  // there is nothing to reinitialise
+  const double frame = std::floor(position);
+  const double bytes = (position - frame) * 10.;
+
+  auto st = smpte_from_frames(int64_t(frame), int(m_fps));
+  ltc_encoder_set_timecode(m_encoder, &st);
+  ltc_time_to_frame(&m_ltc_frame, &st, m_standard, 0);
+
+  // Back to libltc, which handles the part of byte skipped
+  if(m_nominal)
+  {
+    m_nominal = false;
+    m_invert = m_state != m_ltc_state;
+  }
+
+  m_staged = nullptr;
+  m_staged_pos = 0;
+  m_staged_len = 0;
+  m_frame = int64_t(frame);
+  m_current_byte = std::min(int(bytes), 9);
+  m_skip = bytes - m_current_byte;
+}
+
+double LTCBlockEncoder::position() const noexcept
+{
+  if(m_nominal)
+  {
+    const double bit = m_clock.length > 0 ? double(m_clock.pos) / m_clock.length : 1.;
+    return m_frame + (m_clock.bit + bit) / LTCBitClock::bits_per_frame;
+  }
+
+  // The encoder is at the end of what has been staged
+  const double samples_per_frame = m_rate / m_fps * m_staged_speed;
+  return m_frame + (m_current_byte + m_skip) / 10.
+         - (m_staged_len - m_staged_pos) / samples_per_frame;
+}
+
+void LTCBlockEncoder::refill(int needed, double speed) noexcept
+{
+  // Everything staged has been output: encode again from the start of the buffer.
+  // Only what this block needs is encoded, so that speed changes apply on the next
+  // byte, as they would sample by sample.
+  ltc_encoder_buffer_flush(m_encoder);
+
+  // Upper bound of the samples of one byte, with room for the rounding remainder
+  const double byte_samples = m_rate / (m_fps * 10.) * speed + 2.;
+  const double capacity = ltc_encoder_get_buffersize(m_encoder);
+
+  // After a locate, the start of the first byte is encoded then dropped
+  const int skip = int(m_skip * (byte_samples - 2.) + 0.5);
+  m_skip = 0.;
+
+  int len = 0;
+  do
+  {
+    if(ltc_encoder_encode_byte(m_encoder, m_current_byte, speed) != 0)
+      break;
+    m_ltc_state ^= byte_parity(m_ltc_frame, m_current_byte);
+
+    if(++m_current_byte == 10)
+    {
+      ltc_encoder_inc_timecode(m_encoder);
+      ltc_frame_increment(&m_ltc_frame, int(m_fps), m_standard, 0);
+      m_frame++;
+      m_current_byte = 0;
+    }
+
+    len = ltc_encoder_get_bufferptr(m_encoder, &m_staged, 0);
+  } while(len < needed + skip && len + byte_samples < capacity);
+
+  m_staged_pos = std::min(skip, len);
+  m_staged_len = len;
+  m_staged_speed = speed;
+}
+
+void LTCBlockEncoder::enter_nominal() noexcept
+{
+  // On a byte boundary: the bit clock goes right before the byte
+  m_nominal = true;
+  m_state = m_ltc_state != m_invert;
+  m_clock.bit = m_current_byte * 8 - 1;
+  m_clock.length = 0;
+  m_clock.pos = 0;
+}
+
+void LTCBlockEncoder::leave_nominal() noexcept
+{
+  // At the end of a byte: libltc continues with the next one, from the same level
+  m_nominal = false;
+  m_current_byte = m_clock.bit / 8 + 1;
+  if(m_current_byte == 10)
+  {
+    ltc_frame_increment(&m_ltc_frame, int(m_fps), m_standard, 0);
+    m_frame++;
+    m_current_byte = 0;
+  }
+
+  auto st = smpte_from_frames(m_frame, int(m_fps));
+  ltc_encoder_set_timecode(m_encoder, &st);
+  m_invert = m_state != m_ltc_state;
+}
+
+void LTCBlockEncoder::next_bit() noexcept
+{
+  if(m_clock.next(1.))
+  {
+    ltc_frame_increment(&m_ltc_frame, int(m_fps), m_standard, 0);
+    m_frame++;
+  }
+
+  // Every bit starts with a transition; a 1 has a second one that brings back the
+  // previous level
+  m_one = ltc_frame_bit(m_ltc_frame, m_clock.bit);
+  m_first = !m_state;
+  if(!m_one)
+    m_state = !m_state;
+}
+
+void LTCBlockEncoder::copy_run(
+    double* out, int n, int from, int count, bool high) const noexcept
+{
+  if(m_runs.contains(n))
+    std::copy_n(m_runs.run(n, high) + from, count, out);
+  else
+    m_shape.run(out, n, from, count, high ? 1. : -1.);
+}
+
+int LTCBlockEncoder::render_nominal(double* out, int frames, bool leave) noexcept
+{
+  auto& clk = m_clock;
+
+  int done = 0;
+  while(done < frames)
+  {
+    if(clk.pos == clk.length)
+    {
+      if(leave && clk.bit % 8 == 7)
+      {
+        leave_nominal();
+        break;
+      }
+      next_bit();
+    }
+
+    const int n = std::min(frames - done, clk.length - clk.pos);
+    if(!m_one)
+    {
+      copy_run(out + done, clk.length, clk.pos, n, m_first);
+    }
+    else
+    {
+      int k = 0;
+      if(clk.pos < clk.first_half)
+      {
+        k = std::min(n, clk.first_half - clk.pos);
+        copy_run(out + done, clk.first_half, clk.pos, k, m_first);
+      }
+      if(k < n)
+      {
+        copy_run(
+            out + done + k, clk.length - clk.first_half,
+            clk.pos + k - clk.first_half, n - k, !m_first);
+      }
+    }
+
+    clk.pos += n;
+    done += n;
+  }
+  return done;
+}
+
+void LTCBlockEncoder::process(double* out, int frames, double speed) noexcept
+{
+  if(!m_encoder)
+  {
+    std::fill_n(out, frames, 0.);
+    return;
+  }
+
+  if(!(speed > 0.))
+    speed = 1.;
+  speed = std::min(speed, max_speed);
+  const bool nominal = std::abs(speed - 1.) < 1e-9;
+
+  while(frames > 0)
+  {
+    if(m_nominal)
+    {
+      const int n = render_nominal(out, frames, !nominal);
+      out += n;
+      frames -= n;
+      continue;
+    }
+
+    if(m_staged_pos == m_staged_len)
+    {
+      if(nominal && m_skip == 0.)
+      {
+        enter_nominal();
+        continue;
+      }
+
+      refill(frames, speed);
+      if(m_staged_len == 0)
+      {
+        std::fill_n(out, frames, 0.);
+        return;
+      }
+    }
+
+    const int n = std::min(frames, m_staged_len - m_staged_pos);
+    convert_samples(m_staged + m_staged_pos, out, n, m_invert);
+    m_staged_pos += n;
+    out += n;
+    frames -= n;
+  }
+}
+}
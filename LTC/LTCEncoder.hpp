@@ -0,0 +1,114 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "LTCBiphase.hpp"
+
+#include <ltc.h>
+
+#include <cstdint>
+
+namespace ao
+{
+// Time of day of the given number of seconds, at frame 0
+SMPTETimecode smpte_from_seconds(int64_t seconds) noexcept;
+
+// Time of day of the given number of frames, wrapped to [0; 24h)
+SMPTETimecode smpte_from_frames(int64_t frames, int fps) noexcept;
+
+/**
+ * @brief Streams LTC from libltc into audio blocks
+ *
+ * libltc encodes into a buffer of its own, which is used as the staging area:
+ * the bytes covering a whole audio block, up to a frame or more, are encoded at
+ * once, then converted straight into the output channel.
+ *
+ * The buffer is sized in prepare() for a whole frame at the lowest frame rate and
+ * the slowest speed: changing the frame rate or the time later on does not allocate.
+ *
+ * At the nominal speed, libltc is bypassed: the runs of every length that can occur
+ * are rendered once in prepare(), and the bits are copied out of them. The switch
+ * between the two happens on byte boundaries, keeping the polarity of the stream.
+ */
+class LTCBlockEncoder
+{
+public:
+  // Slowest playback handled, as a multiple of the frame duration. 120 / tempo
+  // beyond this, i.e. tempos under 15 BPM, is clamped.
+  static constexpr double max_speed = 8.;
+
+  LTCBlockEncoder() = default;
+  LTCBlockEncoder(const LTCBlockEncoder&) = delete;
+  LTCBlockEncoder& operator=(const LTCBlockEncoder&) = delete;
+  ~LTCBlockEncoder();
+
+  static double fps(LTC_TV_STANDARD standard) noexcept;
+
+  // Allocates the encoder; a rate <= 1 releases it
+  void prepare(double sample_rate);
+
+  explicit operator bool() const noexcept { return m_encoder != nullptr; }
+
+  double fps() const noexcept { return m_fps; }
+
+  // Real-time safe. Restarts the stream at the beginning of the given frame.
+  void reset(LTC_TV_STANDARD standard, const SMPTETimecode& tc) noexcept;
+
+  // Real-time safe. Moves the stream to the given position, in frames since
+  // midnight, keeping the frame rate: the next sample output is the one of the
+  // position, up to the rounding of the byte to samples.
+  void locate(double position) noexcept;
+
+  // Position of the next sample output, in frames since midnight: the frame given
+  // to the last reset or locate plus what has been output since.
+  // Only exact up to the rounding of the runs.
+  double position() const noexcept;
+
+  // Real-time safe. speed is the frame duration relative to the nominal one, as
+  // expected by ltc_encoder_encode_byte.
+  void process(double* out, int frames, double speed) noexcept;
+
+private:
+  void refill(int needed, double speed) noexcept;
+
+  // Nominal speed path
+  void enter_nominal() noexcept;
+  void leave_nominal() noexcept;
+  void next_bit() noexcept;
+  int render_nominal(double* out, int frames, bool leave) noexcept;
+  void copy_run(double* out, int n, int from, int count, bool high) const noexcept;
+
+  LTCEncoder* m_encoder{};
+  double m_rate{};
+  double m_fps{30.};
+  LTC_TV_STANDARD m_standard{LTC_TV_STANDARD::LTC_TV_525_60};
+
+  // Samples encoded by libltc and not output yet, in its own buffer
+  ltcsnd_sample_t* m_staged{};
+  int m_staged_pos{};
+  int m_staged_len{};
+
+  double m_staged_speed{1.};
+
+  // Frame being encoded and next byte of it
+  int64_t m_frame{};
+  int m_current_byte{};
+
+  // Part of the current byte to drop on the next refill, after a locate
+  double m_skip{};
+
+  // Copy of the frame of libltc, and level of its last run
+  LTCFrame m_ltc_frame{};
+  bool m_ltc_state{};
+  // Whether the output of libltc is negated to continue the nominal path
+  bool m_invert{};
+
+  LTCBiphase m_shape;
+  LTCRunTable m_runs;
+  LTCBitClock m_clock;
+  bool m_nominal{};
+  bool m_state{}; // level of the last run output
+  bool m_first{}; // level of the first run of the current bit
+  bool m_one{};   // value of the current bit
+};
+}
@@ -2,14 +2,24 @@
 
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
+#include "LTCDecoderRequest.hpp"
+#include "LTCSamples.hpp"
+#include "ProcessStats.hpp"
+#include "TimecodeMath.hpp"
+#include "TimecodeSnapshot.hpp"
+#include "TimecodeTracker.hpp"
+#include "Worker.hpp"
+
 #include <halp/audio.hpp>
 #include <halp/controls.hpp>
 #include <halp/meta.hpp>
 
 #include <ltc.h>
 
-#include <chrono>
+#include <algorithm>
 #include <cmath>
+#include <memory>
+#include <vector>
 
 namespace ao
 {
@@ -18,6 +28,17 @@ namespace ao
  * LTC (Linear Timecode) Input
  * Decodes LTC timecode from audio input
  * Outputs timecode values, frame rate, and validity status
+ *
+ * The timecode is the one at the first sample of each tick, extrapolated from the
+ * decoded frames by a TimecodeTracker rather than stepping at the frame rate.
+ * The tracker also gives the filtered speed of the source, and whether it is
+ * locked on it.
+ *
+ * Changing the queue size while running does not allocate on the audio thread: the
+ * new decoder is built by the Worker and swapped in, the tracker carries on.
+ *
+ * After every tick, the time code at the end of the tick is also published to
+ * snapshots(), for the threads which need it between ticks.
  */
 struct LTCInput
 {
@@ -38,14 +59,7 @@ struct LTCInput
     Auto = 4
   };
 
-  enum class OutputFormat
-  {
-    Seconds,
-    Milliseconds,
-    Microseconds,
-    Nanoseconds,
-    Flicks
-  };
+  using OutputFormat = TimeFormat;
 
   struct
   {
@@ -56,12 +70,33 @@ struct LTCInput
     } offset;
 
     halp::combobox_t<"Output Format", OutputFormat> format{OutputFormat::Seconds};
-    halp::combobox_t<"Framerate", FrameRate> framerate{FrameRate::Auto};
+
+    // The decoder starts from the samples per frame of the rate
+    struct : halp::combobox_t<"Framerate", FrameRate>
+    {
+      void update(LTCInput& self) { self.request_decoder(); }
+    } framerate{{FrameRate::Auto}};
 
     struct : halp::spinbox_i32<"Queue Size", halp::irange{8, 256, 32}>
     {
-      void update(LTCInput& self) { self.reinit_decoder(); }
+      void update(LTCInput& self) { self.request_decoder(); }
     } queue_size;
+
+    struct
+        : halp::knob_f32<
+              "Bandwidth (Hz)", halp::range{0.1f, 20.f, TimecodeTracker::default_bandwidth}>
+    {
+      void update(LTCInput& self) { self.m_tracker.set_bandwidth(value); }
+    } bandwidth;
+
+    // Blocks whose peak is under this are not decoded
+    halp::knob_f32<"Silence (dBFS)", halp::range{-96.f, 0.f, -60.f}> silence;
+
+    // Without a frame for this long, in seconds of audio, the timecode is invalid
+    halp::knob_f32<"Timeout (s)", halp::range{0.05f, 5.f, 0.5f}> timeout;
+
+    // Fill the Frames and Frame offsets outputs
+    halp::toggle<"Batch frames"> batch;
   } inputs;
 
   struct
@@ -72,222 +107,310 @@ struct LTCInput
     halp::val_port<"Drop Frame", bool> drop_frame{false};
     halp::val_port<"Reverse", bool> reverse{false};
     halp::val_port<"Volume (dBFS)", double> volume{-96.0};
+    halp::val_port<"Speed", double> speed{0.0};
+    halp::val_port<"Locked", bool> locked{false};
+
+    // Every frame decoded in the tick when batching, in the output format, and the
+    // sample where each one starts relative to the start of the tick. The offsets
+    // are usually negative: a frame is decoded once it has been entirely received.
+    halp::val_port<"Frames", std::vector<double>> frames;
+    halp::val_port<"Frame offsets", std::vector<int>> frame_offsets;
+
+#if SCORE_ADDON_LTC_STATS
+    halp::val_port<"Stats: load", double> stats_load;
+    halp::val_port<"Stats: decoded frames", int> stats_decoded;
+    halp::val_port<"Stats: missed frames", int> stats_dropped;
+    halp::val_port<"Stats: decoder changes", int> stats_reinits;
+#endif
   } outputs;
 
   halp::setup m_setup{};
 
+  LTCInput()
+      : m_request{std::make_shared<LTCDecoderRequest>()}
+      , m_publisher{std::make_shared<TimecodePublisher>()}
+  {
+    m_worker_task = Worker::instance().add([req = m_request] { req->process(); });
+  }
+
+  LTCInput(const LTCInput&) = delete;
+  LTCInput& operator=(const LTCInput&) = delete;
+
+  ~LTCInput() { Worker::instance().remove(m_worker_task); }
+
   void prepare(halp::setup setup)
   {
     m_setup = setup;
     reinit_decoder();
+
+    // The decoder never holds more frames than its queue
+    outputs.frames.value.reserve(256);
+    outputs.frame_offsets.value.reserve(256);
   }
 
+  // Not real-time: the audio thread must not be running
   void reinit_decoder()
   {
-    if(m_decoder)
-    {
-      ltc_decoder_free(m_decoder);
-      m_decoder = nullptr;
-    }
-
+    m_decoder = nullptr;
     if(m_setup.rate <= 1)
       return;
 
-    // Calculate audio frames per video frame (assuming 30fps as default)
-    // This is just an initial estimate; libltc tracks speed dynamically
-    int apv = static_cast<int>(m_setup.rate / 30.0);
-    m_decoder = ltc_decoder_create(apv, inputs.queue_size.value);
+    m_decoder = m_request->reset(samples_per_frame(), inputs.queue_size.value);
+    m_stats.count_reinit();
     m_sample_position = 0;
-    m_last_valid_time = std::chrono::steady_clock::now();
+    m_tracker.reset(m_setup.rate);
+    m_tracker.set_bandwidth(inputs.bandwidth.value);
+    m_last_valid_sample = 0;
+    m_max_frame = 0;
   }
 
-  ~LTCInput()
+  // Real-time safe: the decoder is replaced on a later tick
+  void request_decoder() noexcept
   {
-    if(m_decoder)
-    {
-      ltc_decoder_free(m_decoder);
-      m_decoder = nullptr;
-    }
-  }
+    if(m_setup.rate <= 1)
+      return;
 
-  // Get the actual frame rate from LTC frame flags
-  static double get_frame_rate_from_standard(LTC_TV_STANDARD standard, bool drop_frame)
-  {
-    switch(standard)
-    {
-      case LTC_TV_525_60:
-      case LTC_TV_1125_60:
-        return drop_frame ? 29.97 : 30.0;
-      case LTC_TV_625_50:
-        return 25.0;
-      case LTC_TV_FILM_24:
-        return 24.0;
-      default:
-        return 30.0;
-    }
+    m_request->requested.store(
+        LTCDecoderRequest::config(samples_per_frame(), inputs.queue_size.value),
+        std::memory_order_release);
+    Worker::instance().wake();
   }
 
-  // Detect TV standard from frame rate setting or auto-detect
-  LTC_TV_STANDARD detect_standard(const LTCFrame& frame) const
+  // Initial estimate for the decoder, which then follows the speed of the signal
+  int samples_per_frame() const noexcept
   {
-    if(inputs.framerate.value != FrameRate::Auto)
-    {
-      switch(inputs.framerate.value)
-      {
-        case FrameRate::FPS_24:
-          return LTC_TV_FILM_24;
-        case FrameRate::FPS_25:
-          return LTC_TV_625_50;
-        case FrameRate::FPS_2997:
-        case FrameRate::FPS_30:
-        default:
-          return LTC_TV_525_60;
-      }
-    }
-
-    // Auto-detect based on frame values
-    // If frames go up to 24, it's 25fps
-    // If drop-frame bit is set, it's 29.97
-    // Otherwise assume 30fps (or 24fps for film)
-    if(frame.dfbit)
-      return LTC_TV_525_60; // 29.97 drop-frame
-
-    // Heuristic: check max frame value seen
-    int max_frame = frame.frame_tens * 10 + frame.frame_units;
-    if(max_frame >= 25)
-      return LTC_TV_525_60; // 30fps
-    else if(max_frame >= 24)
-      return LTC_TV_625_50; // 25fps
-    else
-      return LTC_TV_FILM_24; // 24fps (or could be higher, but we can't tell yet)
+    return static_cast<int>(m_setup.rate / configured_rate(false).fps());
   }
 
-  double get_configured_fps() const
+  // The rate of the Framerate input, 30 fps in Auto
+  TimecodeRate configured_rate(bool drop_frame) const noexcept
   {
     switch(inputs.framerate.value)
     {
       case FrameRate::FPS_24:
-        return 24.0;
+        return timecode_rate_24;
       case FrameRate::FPS_25:
-        return 25.0;
+        return timecode_rate_25;
       case FrameRate::FPS_2997:
-        return 29.97;
+        return drop_frame ? timecode_rate_2997_drop : timecode_rate_2997;
       case FrameRate::FPS_30:
-        return 30.0;
       case FrameRate::Auto:
       default:
-        return 30.0;
+        return timecode_rate_30;
     }
   }
 
-  double to_seconds(const SMPTETimecode& tc, double fps) const
-  {
-    double total_seconds
-        = tc.hours * 3600.0 + tc.mins * 60.0 + tc.secs + (tc.frame / fps);
-    return total_seconds + inputs.offset.value;
-  }
-
-  double convert_output(double seconds) const
+  double convert_output(double seconds) const noexcept
   {
-    switch(inputs.format.value)
-    {
-      case OutputFormat::Seconds:
-        return seconds;
-      case OutputFormat::Milliseconds:
-        return seconds * 1000.0;
-      case OutputFormat::Microseconds:
-        return seconds * 1e6;
-      case OutputFormat::Nanoseconds:
-        return seconds * 1e9;
-      case OutputFormat::Flicks:
-        return seconds * 705'600'000.0;
-      default:
-        return seconds;
-    }
+    return to_time_format(seconds, inputs.format.value);
   }
 
+  // Counted in samples so that it does not depend on how fast the audio is
+  // processed, e.g. when rendering offline
   void check_timeout()
   {
-    auto now = std::chrono::steady_clock::now();
-    auto elapsed
-        = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_last_valid_time)
-              .count();
-
-    // If no valid frame for more than 500ms, mark as invalid
-    if(elapsed > 500)
+    const double elapsed = double(m_sample_position - m_last_valid_sample);
+    if(elapsed > inputs.timeout.value * m_setup.rate)
     {
       outputs.valid = false;
+      m_tracker.reset(m_setup.rate);
+      m_max_frame = 0;
     }
   }
 
   using tick = halp::tick_flicks;
   void operator()(halp::tick_flicks tk)
   {
-    if(!m_decoder)
-      return;
-
+    // Also the ticks which wait for a decoder
     const int frames = tk.frames;
-    if(frames <= 0)
+    auto timer = m_stats.time_tick(frames, m_setup.rate);
+
+    // Adopt the decoder published by the worker, and acknowledge it so that the
+    // worker can free the previous one. Frames partly decoded by the previous
+    // decoder are lost, the tracker extrapolates over them.
+    if(auto decoder = m_request->published.load(std::memory_order_acquire);
+       decoder && decoder != m_decoder)
+    {
+      m_decoder = decoder;
+      m_request->in_use.store(decoder, std::memory_order_release);
+      Worker::instance().wake();
+      m_stats.count_reinit();
+    }
+
+    if(!m_decoder || frames <= 0)
+    {
+      timer.stop();
+      publish_stats(m_stats, outputs);
       return;
+    }
 
-    // Feed audio samples to the decoder
-    // We need to convert double samples to what libltc expects
-    // libltc provides ltc_decoder_write_double for this
-    ltc_decoder_write_double(
-        m_decoder, inputs.audio.channel, static_cast<size_t>(frames), m_sample_position);
+    // Feed audio samples to the decoder, unless there is no signal: a silent block
+    // costs a peak measurement. The decoder resynchronises on the next frame once
+    // the signal is back.
+    const ltc_off_t block_start = m_sample_position;
+    const double peak = ltc_block_peak(inputs.audio.channel, frames);
+    if(peak > std::pow(10., inputs.silence.value / 20.))
+    {
+      ltc_decoder_write_block(m_decoder, inputs.audio.channel, frames, block_start, peak);
+    }
+    else
+    {
+      outputs.volume = peak > 0. ? 20. * std::log10(peak) : -96.;
+    }
 
     m_sample_position += frames;
+    outputs.frames.value.clear();
+    outputs.frame_offsets.value.clear();
 
     // Read any decoded frames from the queue
     LTCFrameExt ltc_frame;
     bool got_frame = false;
+    double fps = outputs.frame_rate;
 
-    // Process all available frames, keeping the most recent
+    // Process all available frames: they all feed the tracker, the most recent one
+    // gives the frame information
     while(ltc_decoder_read(m_decoder, &ltc_frame) > 0)
     {
+      if(outputs.valid)
+        count_missed_frames(ltc_frame);
+      m_stats.count_decoded();
+
       got_frame = true;
       m_last_frame = ltc_frame;
+
+      fps = track(ltc_frame, block_start);
     }
 
     if(got_frame)
     {
-      m_last_valid_time = std::chrono::steady_clock::now();
-
-      // Convert LTC frame to SMPTE timecode
-      SMPTETimecode tc;
-      ltc_frame_to_time(&tc, &m_last_frame.ltc, 0);
-
-      // Detect frame rate
-      LTC_TV_STANDARD standard = detect_standard(m_last_frame.ltc);
-      bool is_drop_frame = m_last_frame.ltc.dfbit != 0;
-      double fps = get_frame_rate_from_standard(standard, is_drop_frame);
-
-      if(inputs.framerate.value != FrameRate::Auto)
-      {
-        fps = get_configured_fps();
-      }
+      m_last_valid_sample = m_sample_position;
 
       // Update outputs
       outputs.frame_rate = fps;
-      outputs.drop_frame = is_drop_frame;
+      outputs.drop_frame = m_last_frame.ltc.dfbit != 0;
       outputs.reverse = m_last_frame.reverse != 0;
       outputs.volume = m_last_frame.volume;
 
-      double seconds = to_seconds(tc, fps);
-      outputs.timecode = convert_output(seconds);
-
       outputs.valid = true;
     }
 
     // Check for timeout
     check_timeout();
+
+    if(outputs.valid && m_tracker.tracking())
+    {
+      outputs.timecode = convert_output(m_tracker.position(block_start));
+      outputs.speed = m_tracker.speed();
+    }
+    else
+    {
+      outputs.speed = 0.;
+    }
+    outputs.locked = outputs.valid && m_tracker.locked();
+    publish_snapshot();
+    timer.stop();
+    publish_stats(m_stats, outputs);
+  }
+
+  const ProcessStats& stats() const noexcept { return m_stats; }
+
+  // Of the last decoded frame
+  TimecodeRate timecode_rate() const noexcept { return m_rate; }
+
+  // Can be read from any thread, for as long as it is held
+  std::shared_ptr<const TimecodePublisher> snapshots() const noexcept
+  {
+    return m_publisher;
   }
 
 private:
+  // In seconds, as the tracker extrapolates it to the end of the tick
+  void publish_snapshot() noexcept
+  {
+    const bool valid = outputs.valid && m_tracker.tracking();
+    TimecodeSnapshot s{};
+    s.seconds = valid ? m_tracker.position(m_sample_position) : 0.;
+    s.speed = outputs.speed;
+    s.sample = m_sample_position;
+    s.steady_ns = TimecodeSnapshot::now_ns();
+    s.valid = valid;
+    m_publisher->publish(s);
+  }
+
+  // Until the highest frame number of the rate has been seen, Auto underestimates
+  // the rate
+  TimecodeRate frame_rate(const LTCFrame& frame, int frame_number) noexcept
+  {
+    const bool drop_frame = frame.dfbit != 0;
+    if(inputs.framerate.value != FrameRate::Auto)
+      return configured_rate(drop_frame);
+
+    m_max_frame = std::max(m_max_frame, frame_number);
+    return detect_timecode_rate(drop_frame, m_max_frame);
+  }
+
+  // Frames that fit in the gap since the previous one were not decoded
+  void count_missed_frames(const LTCFrameExt& frame) noexcept
+  {
+    if constexpr(ProcessStats::enabled)
+    {
+      const auto& prev = m_last_frame;
+      const double gap = double(std::max(
+          frame.off_start - prev.off_end, prev.off_start - frame.off_end) - 1);
+      const double length = double(frame.off_end - frame.off_start + 1);
+      if(length > 0. && gap > length / 2.)
+        m_stats.count_dropped(static_cast<uint64_t>(std::lround(gap / length)));
+    }
+  }
+
+  // Returns the frame rate of the frame
+  double track(LTCFrameExt& frame, ltc_off_t block_start)
+  {
+    // Convert LTC frame to SMPTE timecode
+    SMPTETimecode tc;
+    ltc_frame_to_time(&tc, &frame.ltc, 0);
+    const auto rate = frame_rate(frame.ltc, tc.frame);
+    const double fps = rate.fps();
+    m_rate = rate;
+    const int64_t count = timecode_frames(tc.hours, tc.mins, tc.secs, tc.frame, rate);
+
+    // The time code is the one of the start of the frame, which is read last when
+    // playing backwards
+    const bool reverse = frame.reverse != 0;
+    const ltc_off_t start = reverse ? frame.off_end : frame.off_start;
+
+    const double length = double(frame.off_end - frame.off_start + 1);
+    const double speed = length > 0. ? m_setup.rate / fps / length : 1.;
+
+    const int offset = inputs.offset.value;
+    const double seconds = frames_to_seconds(count, rate) + offset;
+    m_tracker.observe(start, seconds, reverse ? -speed : speed);
+
+    // Exact, from the frame count, rather than through the seconds
+    if(inputs.batch && outputs.frames.value.size() < outputs.frames.value.capacity())
+    {
+      const auto format = inputs.format.value;
+      outputs.frames.value.push_back(
+          frames_to_time_format(count, rate, format)
+          + double(offset * time_units_per_second[int(format)]));
+      outputs.frame_offsets.value.push_back(static_cast<int>(start - block_start));
+    }
+    return fps;
+  }
+
+  std::shared_ptr<LTCDecoderRequest> m_request;
+  std::shared_ptr<TimecodePublisher> m_publisher;
+  int m_worker_task{-1};
+
+  // Owned by m_request
   LTCDecoder* m_decoder{};
   ltc_off_t m_sample_position{0};
   LTCFrameExt m_last_frame{};
-  std::chrono::steady_clock::time_point m_last_valid_time{};
+  TimecodeTracker m_tracker;
+  ltc_off_t m_last_valid_sample{0};
+  int m_max_frame{0};
+  TimecodeRate m_rate{};
+  ProcessStats m_stats;
 };
 
 } // namespace ao
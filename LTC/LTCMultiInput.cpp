@@ -0,0 +1,135 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "LTCMultiInput.hpp"
+
+#include "LTCSamples.hpp"
+#include "TimecodeMath.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ao
+{
+
+// Without a frame for this long, in seconds, a channel goes back to detection
+static constexpr double frame_timeout = 0.5;
+
+// Frames decoded per channel and tick are read right away: a short queue is enough
+static constexpr int queue_size = 8;
+
+void LTCMultiInput::prepare(halp::setup setup)
+{
+  m_setup = setup;
+  m_sample_position = 0;
+  m_channels.clear();
+
+  if(setup.rate <= 1)
+    return;
+
+  m_channels.resize(std::max(setup.input_channels, 0));
+  for(auto& c : m_channels)
+  {
+    c.decoder.reset(ltc_decoder_create(static_cast<int>(setup.rate / 30.), queue_size));
+    c.detector.reset(setup.rate);
+    c.tracker.reset(setup.rate);
+  }
+
+  outputs.timecodes.value.reserve(m_channels.size());
+  outputs.channels.value.reserve(m_channels.size());
+}
+
+void LTCMultiInput::attach(channel& c) noexcept
+{
+  ltc_decoder_queue_flush(c.decoder.get());
+  c.tracker.reset(m_setup.rate);
+  c.last_frame = m_sample_position;
+  c.max_frame = 0;
+  c.rate = timecode_rate_24;
+  c.active = true;
+}
+
+void LTCMultiInput::detach(channel& c) noexcept
+{
+  c.detector.reset(m_setup.rate);
+  c.tracker.reset(m_setup.rate);
+  c.active = false;
+}
+
+void LTCMultiInput::decode(channel& c, const double* in, int frames, double peak) noexcept
+{
+  ltc_decoder_write_block(c.decoder.get(), in, frames, m_sample_position, peak);
+
+  LTCFrameExt frame;
+  while(ltc_decoder_read(c.decoder.get(), &frame) > 0)
+  {
+    SMPTETimecode tc;
+    ltc_frame_to_time(&tc, &frame.ltc, 0);
+
+    // Until the highest frame number of the rate has been seen, the rate is
+    // underestimated: the tracker restarts when it is corrected, rather than
+    // filtering the jump of the time code as an error
+    c.max_frame = std::max(c.max_frame, int(tc.frame));
+    const auto rate = detect_timecode_rate(frame.ltc.dfbit != 0, c.max_frame);
+    if(rate != c.rate)
+    {
+      c.tracker.reset(m_setup.rate);
+      c.rate = rate;
+    }
+    const double fps = rate.fps();
+
+    const bool reverse = frame.reverse != 0;
+    const ltc_off_t start = reverse ? frame.off_end : frame.off_start;
+    const double length = double(frame.off_end - frame.off_start + 1);
+    const double speed = length > 0. ? m_setup.rate / fps / length : 1.;
+
+    const double seconds = timecode_seconds(tc.hours, tc.mins, tc.secs, tc.frame, rate)
+                           + inputs.offset.value;
+    c.tracker.observe(start, seconds, reverse ? -speed : speed);
+    c.last_frame = m_sample_position + frames;
+  }
+}
+
+void LTCMultiInput::operator()(halp::tick_flicks tk)
+{
+  const int frames = tk.frames;
+  const int count = std::min(inputs.audio.channels, static_cast<int>(m_channels.size()));
+
+  // Within the capacity reserved in prepare()
+  auto& timecodes = outputs.timecodes.value;
+  auto& channels = outputs.channels.value;
+  timecodes.assign(count, 0.);
+  channels.clear();
+
+  if(frames <= 0)
+    return;
+
+  const double silence = std::pow(10., inputs.silence.value / 20.);
+  const auto timeout = static_cast<int64_t>(frame_timeout * m_setup.rate);
+
+  for(int i = 0; i < count; i++)
+  {
+    auto& c = m_channels[i];
+    const double* in = inputs.audio.samples[i];
+
+    const double peak = ltc_block_peak(in, frames);
+    if(peak > silence)
+    {
+      if(c.active)
+        decode(c, in, frames, peak);
+      else if(c.detector.process(in, frames))
+        attach(c);
+    }
+
+    if(c.active && m_sample_position + frames - c.last_frame > timeout)
+      detach(c);
+
+    if(c.active && c.tracker.tracking())
+    {
+      timecodes[i] = c.tracker.position(m_sample_position);
+      channels.push_back(i);
+    }
+  }
+
+  m_sample_position += frames;
+}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "LTCSyncDetector.hpp"
+#include "TimecodeMath.hpp"
+#include "TimecodeTracker.hpp"
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <ltc.h>
+
+#include <memory>
+#include <vector>
+
+namespace ao
+{
+/**
+ * @brief LTC decoding over all the channels of a bus
+ *
+ * Every channel goes through an LTCSyncDetector until LTC is found in it: only
+ * then is its libltc decoder fed, until no frame has been decoded for a while.
+ * The decoders are all created in prepare(), attaching one does not allocate.
+ *
+ * The frame rate of each channel is found from the highest frame number seen.
+ */
+struct LTCMultiInput
+{
+  halp_meta(name, "LTC Multi Input")
+  halp_meta(author, "ossia team")
+  halp_meta(category, "Audio/Timing")
+  halp_meta(manual_url, "https://ossia.io/score-docs/processes/ltc-input.html")
+  halp_meta(c_name, "avnd_ltc_multi_input")
+  halp_meta(uuid, "1fcb6615-f74e-4e49-addb-1b43ee433478")
+  halp_meta(description, "Find and decode LTC in any channel of a multichannel input")
+
+  struct
+  {
+    halp::dynamic_audio_bus<"LTC Audio", double> audio;
+
+    halp::spinbox_i32<"Offset (s)", halp::irange{-128000, 128000, 0}> offset;
+
+    // Blocks whose peak is under this are neither searched nor decoded
+    halp::knob_f32<"Silence (dBFS)", halp::range{-96.f, 0.f, -60.f}> silence;
+  } inputs;
+
+  struct
+  {
+    // In seconds, one per input channel, 0 where there is no LTC
+    halp::val_port<"Timecodes", std::vector<double>> timecodes;
+
+    // Input channels where LTC is being decoded
+    halp::val_port<"LTC channels", std::vector<int>> channels;
+  } outputs;
+
+  void prepare(halp::setup setup);
+
+  using tick = halp::tick_flicks;
+  void operator()(halp::tick_flicks tk);
+
+private:
+  struct decoder_deleter
+  {
+    void operator()(LTCDecoder* d) const noexcept { ltc_decoder_free(d); }
+  };
+
+  struct channel
+  {
+    std::unique_ptr<LTCDecoder, decoder_deleter> decoder;
+    LTCSyncDetector detector;
+    TimecodeTracker tracker;
+
+    // Input sample of the last decoded frame, and highest frame number seen
+    int64_t last_frame{};
+    int max_frame{};
+    // Detected from max_frame, in which the tracker follows the time code
+    TimecodeRate rate{timecode_rate_24};
+    bool active{};
+  };
+
+  void attach(channel& c) noexcept;
+  void detach(channel& c) noexcept;
+  void decode(channel& c, const double* in, int frames, double peak) noexcept;
+
+  halp::setup m_setup{};
+  std::vector<channel> m_channels;
+  int64_t m_sample_position{};
+};
+}
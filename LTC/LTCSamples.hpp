@@ -0,0 +1,79 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <ltc.h>
+
+#include <cmath>
+#include <cstdint>
+
+namespace ao
+{
+// Samples converted at once for the decoder, on the stack
+static constexpr int ltc_chunk_size = 1024;
+
+// Largest absolute value of a block. The four independent maxima let the loop
+// vectorise without -ffast-math.
+inline double ltc_block_peak(const double* in, int n) noexcept
+{
+  double m[4]{};
+  int i = 0;
+  for(; i + 4 <= n; i += 4)
+  {
+    for(int k = 0; k < 4; k++)
+    {
+      const double a = std::abs(in[i + k]);
+      m[k] = a > m[k] ? a : m[k];
+    }
+  }
+  for(; i < n; i++)
+  {
+    const double a = std::abs(in[i]);
+    m[0] = a > m[0] ? a : m[0];
+  }
+
+  const double m01 = m[0] > m[1] ? m[0] : m[1];
+  const double m23 = m[2] > m[3] ? m[2] : m[3];
+  return m01 > m23 ? m01 : m23;
+}
+
+// [-1; 1] to the unsigned 8-bit samples of libltc, as ltc_decoder_write_double
+// does, written so that it vectorises. Clamping costs about twice the conversion:
+// it is only done when the block goes beyond [-1; 1].
+inline void to_ltc_samples(
+    const double* __restrict in, ltcsnd_sample_t* __restrict out, int n,
+    bool clamp) noexcept
+{
+  if(!clamp)
+  {
+    for(int i = 0; i < n; i++)
+      out[i] = static_cast<ltcsnd_sample_t>(static_cast<int32_t>(in[i] * 127. + 128.));
+  }
+  else
+  {
+    for(int i = 0; i < n; i++)
+    {
+      int32_t v = static_cast<int32_t>(in[i] * 127. + 128.);
+      v = v > 1 ? v : 1;
+      v = v < 255 ? v : 255;
+      out[i] = static_cast<ltcsnd_sample_t>(v);
+    }
+  }
+}
+
+// Feeds a block to the decoder through to_ltc_samples. peak is the one of the
+// block, from ltc_block_peak.
+inline void ltc_decoder_write_block(
+    LTCDecoder* decoder, const double* in, int n, ltc_off_t position,
+    double peak) noexcept
+{
+  ltcsnd_sample_t chunk[ltc_chunk_size];
+  for(int done = 0; done < n;)
+  {
+    const int count = n - done < ltc_chunk_size ? n - done : ltc_chunk_size;
+    to_ltc_samples(in + done, chunk, count, peak > 1.);
+    ltc_decoder_write(decoder, chunk, count, position + done);
+    done += count;
+  }
+}
+}
@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "LTCSyncDetector.hpp"
+
+namespace ao
+{
+
+// Bits 64 to 79 of a frame in transmission order, and the same read backwards
+static constexpr uint16_t sync_forward = 0x3FFD;
+static constexpr uint16_t sync_backward = 0xBFFC;
+
+// Around -40 dBFS: LTC is at least 20 dB above that
+static constexpr double hysteresis = 0.01;
+
+void LTCSyncDetector::reset(double sample_rate) noexcept
+{
+  m_min_interval = sample_rate / (30. * 80.) / 2. / 5.;
+  m_max_interval = sample_rate / (24. * 80.) * 4.;
+  m_bit_length = sample_rate / (25. * 80.);
+  m_count = 0;
+  m_level = false;
+  m_half = false;
+  m_bits = 0;
+}
+
+void LTCSyncDetector::transition(int interval, bool& found) noexcept
+{
+  if(interval < m_min_interval || interval > m_max_interval)
+  {
+    m_half = false;
+    m_bits = 0;
+    return;
+  }
+
+  bool bit{};
+  if(interval * 4. < m_bit_length * 3.)
+  {
+    // Half of a 1: the bit is complete with the second half
+    m_bit_length += 0.25 * (2. * interval - m_bit_length);
+    m_half = !m_half;
+    if(m_half)
+      return;
+    bit = true;
+  }
+  else
+  {
+    m_bit_length += 0.25 * (interval - m_bit_length);
+    if(m_half)
+    {
+      // A lone half: out of phase, start over
+      m_half = false;
+      m_bits = 0;
+      return;
+    }
+    bit = false;
+  }
+
+  m_bits = uint16_t(m_bits << 1) | bit;
+  found |= m_bits == sync_forward || m_bits == sync_backward;
+}
+
+bool LTCSyncDetector::process(const double* in, int n) noexcept
+{
+  bool found = false;
+  for(int i = 0; i < n; i++)
+  {
+    m_count += m_count < (1 << 30);
+    const bool level = m_level ? in[i] > -hysteresis : in[i] > hysteresis;
+    if(level != m_level)
+    {
+      m_level = level;
+      transition(m_count, found);
+      m_count = 0;
+    }
+  }
+  return found;
+}
+}
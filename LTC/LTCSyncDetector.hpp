@@ -0,0 +1,40 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <cstdint>
+
+namespace ao
+{
+/**
+ * @brief Cheap detection of LTC in a channel
+ *
+ * Only looks for the sync word that ends every frame, forwards or backwards:
+ * transitions are found with a hysteresis around zero, classified as half or whole
+ * bits against a running estimate of the bit length, and the last 16 bits compared
+ * with the sync word. This is a counter and a couple of comparisons per sample,
+ * with none of the filtering and the frame handling of libltc's decoder.
+ */
+class LTCSyncDetector
+{
+public:
+  void reset(double sample_rate) noexcept;
+
+  // Returns true when a sync word was seen in the block
+  bool process(const double* in, int n) noexcept;
+
+private:
+  void transition(int interval, bool& found) noexcept;
+
+  // Run lengths accepted, in samples: from a whole bit 4x slower at 24 fps to half a
+  // bit 5x faster at 30 fps, so that 4x stays within the rounding to samples
+  double m_min_interval{};
+  double m_max_interval{};
+
+  double m_bit_length{};
+  int m_count{};
+  bool m_level{};
+  bool m_half{};
+  uint16_t m_bits{};
+};
+}
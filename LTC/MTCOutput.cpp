@@ -0,0 +1,193 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "MTCOutput.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ao
+{
+
+// Under this speed, the time code counts as standing still
+static constexpr double min_speed = 0.1;
+
+// Far above the rounding errors of the time code, in samples: a quarter frame
+// which falls on a sample goes out on it whatever the block size
+static constexpr double sample_tolerance = 1e-6;
+
+// Rate bits of the hours of MTC
+static constexpr uint8_t mtc_rate_code(TimecodeRate rate) noexcept
+{
+  if(rate == timecode_rate_24)
+    return 0;
+  if(rate == timecode_rate_25)
+    return 1;
+  if(rate == timecode_rate_2997_drop)
+    return 2;
+  return 3;
+}
+
+void MTCScheduler::reset() noexcept
+{
+  m_running = false;
+  m_last_frame = -1;
+}
+
+void MTCScheduler::quarter_frame(
+    int64_t quarter, int offset, std::vector<halp::midi_msg>& out)
+{
+  // The labels of the frame where the sequence starts
+  const int piece = static_cast<int>(quarter & 7);
+  const auto tc = timecode_labels((quarter - piece) / 4, m_rate);
+
+  int value{};
+  switch(piece)
+  {
+    case 0:
+      value = tc.frame & 0xF;
+      break;
+    case 1:
+      value = tc.frame >> 4;
+      break;
+    case 2:
+      value = tc.secs & 0xF;
+      break;
+    case 3:
+      value = tc.secs >> 4;
+      break;
+    case 4:
+      value = tc.mins & 0xF;
+      break;
+    case 5:
+      value = tc.mins >> 4;
+      break;
+    case 6:
+      value = tc.hours & 0xF;
+      break;
+    case 7:
+      value = (tc.hours >> 4) | (mtc_rate_code(m_rate) << 1);
+      break;
+  }
+
+  out.push_back({{0xF1, static_cast<uint8_t>((piece << 4) | value)}, offset});
+}
+
+void MTCScheduler::full_frame(int64_t frame, int offset, std::vector<halp::midi_msg>& out)
+{
+  const auto tc = timecode_labels(frame, m_rate);
+  out.push_back(
+      {{0xF0, 0x7F, 0x7F, 0x01, 0x01,
+        static_cast<uint8_t>((mtc_rate_code(m_rate) << 5) | tc.hours),
+        static_cast<uint8_t>(tc.mins), static_cast<uint8_t>(tc.secs),
+        static_cast<uint8_t>(tc.frame), 0xF7},
+       offset});
+}
+
+void MTCScheduler::process(
+    const TimecodeSnapshot& snapshot, TimecodeRate rate, int frames,
+    double sample_rate, std::vector<halp::midi_msg>& out)
+{
+  const double end = snapshot.seconds;
+  const double start = end - snapshot.speed * frames / sample_rate;
+
+  // MTC has no negative times
+  if(!snapshot.valid || frames <= 0 || sample_rate <= 0. || std::min(start, end) < 0.)
+  {
+    reset();
+    return;
+  }
+
+  if(rate != m_rate)
+  {
+    m_rate = rate;
+    reset();
+  }
+
+  const double fps = rate.fps();
+  if(snapshot.speed < min_speed)
+  {
+    m_running = false;
+    const auto frame = static_cast<int64_t>(end * fps);
+    if(frame != m_last_frame)
+      full_frame(frame, frames - 1, out);
+    m_last_frame = frame;
+    return;
+  }
+
+  // Within a frame of the expected time code, the tracker only corrected it
+  const double quarter = 1. / (4. * fps);
+  if(!m_running || std::abs(start - m_expected) > 1. / fps)
+  {
+    full_frame(static_cast<int64_t>(start * fps), 0, out);
+    m_next = static_cast<int64_t>(start / quarter) + 1;
+    m_running = true;
+  }
+  m_expected = end;
+  m_last_frame = -1;
+
+  // Those on the sample after the block are for the next one
+  const double samples_per_second = sample_rate / snapshot.speed;
+  for(;; m_next++)
+  {
+    const double at
+        = std::ceil((m_next * quarter - start) * samples_per_second - sample_tolerance);
+    if(at >= frames)
+      break;
+
+    if(out.size() >= std::size_t(max_messages))
+    {
+      m_running = false;
+      break;
+    }
+    quarter_frame(m_next, std::max(int(at), 0), out);
+  }
+}
+
+MTCOutput::MTCOutput()
+    : m_snapshots{m_input.snapshots()}
+{
+}
+
+void MTCOutput::configure() noexcept
+{
+  m_input.inputs.offset.value = inputs.offset.value;
+  if(m_input.inputs.framerate.value != inputs.framerate.value)
+  {
+    m_input.inputs.framerate.value = inputs.framerate.value;
+    m_input.request_decoder();
+  }
+  m_input.inputs.silence.value = inputs.silence.value;
+  m_input.inputs.timeout.value = inputs.timeout.value;
+  m_input.inputs.format.value = TimeFormat::Seconds;
+}
+
+void MTCOutput::prepare(halp::setup setup)
+{
+  m_setup = setup;
+  configure();
+  m_input.prepare(setup);
+  m_scheduler.reset();
+
+  outputs.midi.midi_messages.reserve(MTCScheduler::max_messages);
+}
+
+void MTCOutput::operator()(halp::tick_flicks tk)
+{
+  // Within the capacity reserved in prepare()
+  outputs.midi.midi_messages.clear();
+
+  configure();
+  m_input.inputs.audio.channel = inputs.audio.channel;
+  m_input(tk);
+
+  // Published by the decoder on this thread: there is no race to lose
+  TimecodeSnapshot snapshot{};
+  if(!m_snapshots->read(snapshot))
+    snapshot.valid = false;
+
+  m_scheduler.process(
+      snapshot, m_input.timecode_rate(), tk.frames, m_setup.rate,
+      outputs.midi.midi_messages);
+  outputs.valid = snapshot.valid;
+}
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "LTCInput.hpp"
+#include "TimecodeMath.hpp"
+#include "TimecodeSnapshot.hpp"
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+#include <halp/midi.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ao
+{
+/**
+ * @brief MIDI Time Code messages of a time code, at the samples they fall on
+ *
+ * Quarter frames go out 8 for every 2 frames, at the sample where the time code
+ * reaches each of them, from the time code and speed at the end of each block:
+ * their timing does not depend on the block size. A sequence starts on an even
+ * frame count and carries the labels of that frame.
+ *
+ * A full-frame message is sent instead at the start of a block when the time
+ * code jumps or comes back, and for each new frame while it stands still or goes
+ * backwards.
+ */
+class MTCScheduler
+{
+public:
+  // At most this many messages per block: beyond, the scheduler resynchronises
+  // with a full frame on the next block
+  static constexpr int max_messages = 128;
+
+  void reset() noexcept;
+
+  // The snapshot is the time code at the end of the block of `frames` samples.
+  // Messages are appended to out, with their offset in the block.
+  void process(
+      const TimecodeSnapshot& snapshot, TimecodeRate rate, int frames,
+      double sample_rate, std::vector<halp::midi_msg>& out);
+
+private:
+  void quarter_frame(int64_t quarter, int offset, std::vector<halp::midi_msg>& out);
+  void full_frame(int64_t frame, int offset, std::vector<halp::midi_msg>& out);
+
+  TimecodeRate m_rate{};
+  int64_t m_next{0};        // Next quarter frame, counted from 00:00:00:00
+  int64_t m_last_frame{-1}; // Of the last full frame, when not running
+  double m_expected{0.};    // Time code at the start of the next block
+  bool m_running{false};
+};
+
+/**
+ * MTC Output
+ * Decodes LTC from audio input, as LTC Input, and sends it as MIDI Time Code
+ *
+ * The rate of the MTC is that of the LTC. 29.97 fps without drop frames, which
+ * MTC cannot describe, is sent as 30 fps.
+ */
+struct MTCOutput
+{
+  halp_meta(name, "MTC Output")
+  halp_meta(author, "ossia team")
+  halp_meta(category, "Audio/Timing")
+  halp_meta(manual_url, "https://ossia.io/score-docs/processes/mtc-output.html")
+  halp_meta(c_name, "avnd_mtc_output")
+  halp_meta(uuid, "0b7c52d5-7a3e-4f43-9a1e-5d0f8e6c2a47")
+  halp_meta(description, "Send the LTC of an audio input as MIDI Time Code")
+
+  struct
+  {
+    halp::audio_channel<"LTC Audio", double> audio;
+    halp::spinbox_i32<"Offset (s)", halp::irange{-128000, 128000, 0}> offset;
+    halp::combobox_t<"Framerate", LTCInput::FrameRate> framerate{
+        LTCInput::FrameRate::Auto};
+    halp::knob_f32<"Silence (dBFS)", halp::range{-96.f, 0.f, -60.f}> silence;
+    halp::knob_f32<"Timeout (s)", halp::range{0.05f, 5.f, 0.5f}> timeout;
+  } inputs;
+
+  struct
+  {
+    halp::midi_out_bus<"MTC"> midi;
+    halp::val_port<"Valid", bool> valid{false};
+  } outputs;
+
+  MTCOutput();
+
+  void prepare(halp::setup setup);
+
+  using tick = halp::tick_flicks;
+  void operator()(halp::tick_flicks tk);
+
+private:
+  // Copies the settings of the process to the decoder
+  void configure() noexcept;
+
+  halp::setup m_setup{};
+  LTCInput m_input;
+  std::shared_ptr<const TimecodePublisher> m_snapshots;
+  MTCScheduler m_scheduler;
+};
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <atomic>
+#include <cstdint>
+
+#if SCORE_ADDON_LTC_STATS
+#include <chrono>
+#include <utility>
+#endif
+
+namespace ao
+{
+/**
+ * @brief Counters of a processor, for capacity planning
+ *
+ * Only built with SCORE_ADDON_LTC_STATS: otherwise every member is a no-op that
+ * compiles away, and the processors have no statistics ports.
+ *
+ * The audio thread is the only writer. The counters are relaxed atomics, so any
+ * other thread can read them at any time without locking, although not as a
+ * consistent snapshot.
+ */
+#if SCORE_ADDON_LTC_STATS
+struct ProcessStats
+{
+  static constexpr bool enabled = true;
+
+  std::atomic<uint64_t> ticks{};
+  std::atomic<uint64_t> busy_ns{};
+  std::atomic<uint64_t> max_tick_ns{};
+  std::atomic<uint64_t> decoded{};
+  std::atomic<uint64_t> dropped{};
+  std::atomic<uint64_t> reinits{};
+  std::atomic<uint64_t> lut_build_ns{};
+
+  // Duration of the last tick in proportion of its audio duration
+  std::atomic<double> load{};
+
+  static void add(std::atomic<uint64_t>& counter, uint64_t n = 1) noexcept
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  void count_decoded(uint64_t n = 1) noexcept { add(decoded, n); }
+  void count_dropped(uint64_t n = 1) noexcept { add(dropped, n); }
+  void count_reinit() noexcept { add(reinits); }
+  void set_lut_build_time(uint64_t ns) noexcept
+  {
+    lut_build_ns.store(ns, std::memory_order_relaxed);
+  }
+
+  // Measures a tick from its construction to stop(), or else to its destruction
+  class tick_timer
+  {
+  public:
+    tick_timer(ProcessStats& stats, int frames, double rate) noexcept
+        : m_stats{stats}
+        , m_duration_ns{rate > 0. ? frames * 1e9 / rate : 0.}
+        , m_start{std::chrono::steady_clock::now()}
+    {
+    }
+
+    ~tick_timer() { stop(); }
+
+    // Records the tick, once: call it before publishing the statistics
+    void stop() noexcept
+    {
+      if(std::exchange(m_stopped, true))
+        return;
+
+      const auto ns = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now() - m_start)
+                                   .count());
+      add(m_stats.ticks);
+      add(m_stats.busy_ns, ns);
+      if(ns > m_stats.max_tick_ns.load(std::memory_order_relaxed))
+        m_stats.max_tick_ns.store(ns, std::memory_order_relaxed);
+      if(m_duration_ns > 0.)
+        m_stats.load.store(ns / m_duration_ns, std::memory_order_relaxed);
+    }
+
+  private:
+    ProcessStats& m_stats;
+    double m_duration_ns;
+    std::chrono::steady_clock::time_point m_start;
+    bool m_stopped{false};
+  };
+
+  tick_timer time_tick(int frames, double rate) noexcept { return {*this, frames, rate}; }
+};
+#else
+struct ProcessStats
+{
+  static constexpr bool enabled = false;
+
+  void count_decoded(uint64_t = 1) noexcept { }
+  void count_dropped(uint64_t = 1) noexcept { }
+  void count_reinit() noexcept { }
+  void set_lut_build_time(uint64_t) noexcept { }
+
+  struct tick_timer
+  {
+    void stop() noexcept { }
+  };
+  tick_timer time_tick(int, double) noexcept { return {}; }
+};
+#endif
+
+// Copies the counters to the statistics ports of a processor, if any
+template <typename Outputs>
+void publish_stats(
+    [[maybe_unused]] const ProcessStats& stats, [[maybe_unused]] Outputs& outputs) noexcept
+{
+#if SCORE_ADDON_LTC_STATS
+  constexpr auto relaxed = std::memory_order_relaxed;
+  outputs.stats_load.value = stats.load.load(relaxed);
+  outputs.stats_decoded.value = int(stats.decoded.load(relaxed));
+  outputs.stats_dropped.value = int(stats.dropped.load(relaxed));
+  outputs.stats_reinits.value = int(stats.reinits.load(relaxed));
+  if constexpr(requires { outputs.stats_lut_build.value; })
+    outputs.stats_lut_build.value = stats.lut_build_ns.load(relaxed) / 1e6;
+#endif
+}
+}
@@ -0,0 +1,202 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "TimecodeIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace ao
+{
+
+struct TimecodeIndex::header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+  double rate;
+  uint64_t reserved;
+};
+
+static constexpr char index_magic[8] = {'A', 'O', 'T', 'C', 'I', 'D', 'X', '\0'};
+static constexpr uint32_t index_version = 1;
+
+static constexpr std::size_t align8(std::size_t n) noexcept
+{
+  return (n + 7) & ~std::size_t(7);
+}
+
+// Layout of the sections after the header
+struct index_layout
+{
+  std::size_t runs, order, max_end, size;
+
+  explicit index_layout(std::size_t count) noexcept
+      : runs{32}
+      , order{runs + count * sizeof(TimecodeIndexRun)}
+      , max_end{align8(order + count * sizeof(uint32_t))}
+      , size{max_end + count * sizeof(double)}
+  {
+  }
+};
+
+// Time codes covered by a run, from the lowest to the highest
+static double run_begin(const TimecodeIndexRun& r, double rate) noexcept
+{
+  return std::min(r.seconds, r.seconds + r.speed * r.length / rate);
+}
+
+static double run_end(const TimecodeIndexRun& r, double rate) noexcept
+{
+  return std::max(r.seconds, r.seconds + r.speed * r.length / rate);
+}
+
+std::vector<std::byte>
+TimecodeIndex::build(double rate, std::span<const TimecodeIndexRun> runs)
+{
+  static_assert(sizeof(header) == 32);
+  const auto count = static_cast<uint32_t>(runs.size());
+  const index_layout layout{count};
+  std::vector<std::byte> data(layout.size);
+
+  header h{};
+  std::memcpy(h.magic, index_magic, sizeof(h.magic));
+  h.version = index_version;
+  h.count = count;
+  h.rate = rate;
+  std::memcpy(data.data(), &h, sizeof(h));
+  if(count > 0)
+    std::memcpy(data.data() + layout.runs, runs.data(), runs.size_bytes());
+
+  std::vector<uint32_t> order(count);
+  std::iota(order.begin(), order.end(), 0u);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return run_begin(runs[a], rate) < run_begin(runs[b], rate);
+  });
+
+  std::vector<double> max_end(count);
+  double m = -std::numeric_limits<double>::infinity();
+  for(uint32_t i = 0; i < count; i++)
+  {
+    m = std::max(m, run_end(runs[order[i]], rate));
+    max_end[i] = m;
+  }
+
+  if(count > 0)
+  {
+    std::memcpy(data.data() + layout.order, order.data(), count * sizeof(uint32_t));
+    std::memcpy(data.data() + layout.max_end, max_end.data(), count * sizeof(double));
+  }
+  return data;
+}
+
+bool TimecodeIndex::open(const void* data, std::size_t size) noexcept
+{
+  *this = {};
+
+  // The sections are read in place: the data must be aligned for them
+  if(!data || size < sizeof(header) || reinterpret_cast<std::uintptr_t>(data) % 8)
+    return false;
+
+  auto h = static_cast<const header*>(data);
+  if(std::memcmp(h->magic, index_magic, sizeof(index_magic))
+     || h->version != index_version || !(h->rate > 0.))
+    return false;
+
+  const index_layout layout{h->count};
+  if(size < layout.size)
+    return false;
+
+  auto bytes = static_cast<const std::byte*>(data);
+  const std::span runs{
+      reinterpret_cast<const TimecodeIndexRun*>(bytes + layout.runs), h->count};
+  const std::span order{reinterpret_cast<const uint32_t*>(bytes + layout.order), h->count};
+  const std::span max_end{
+      reinterpret_cast<const double*>(bytes + layout.max_end), h->count};
+
+  // The lookups rely on the order of both sections: a corrupt or foreign file of
+  // the right size would make them read out of bounds or miss runs
+  for(std::size_t i = 0; i < runs.size(); i++)
+  {
+    const auto& r = runs[i];
+    if(r.length < 0 || (i > 0 && r.sample < runs[i - 1].sample + runs[i - 1].length))
+      return false;
+  }
+
+  for(std::size_t i = 0; i < order.size(); i++)
+  {
+    if(order[i] >= h->count)
+      return false;
+
+    // Written so that NaNs fail too
+    const auto& r = runs[order[i]];
+    if(!(max_end[i] >= run_end(r, h->rate)))
+      return false;
+    if(i > 0
+       && !(run_begin(r, h->rate) >= run_begin(runs[order[i - 1]], h->rate)
+            && max_end[i] >= max_end[i - 1]))
+      return false;
+  }
+
+  m_header = h;
+  m_runs = runs;
+  m_order = order;
+  m_max_end = max_end;
+  return true;
+}
+
+double TimecodeIndex::rate() const noexcept
+{
+  return m_header ? m_header->rate : 0.;
+}
+
+const TimecodeIndexRun* TimecodeIndex::find(int64_t sample) const noexcept
+{
+  auto it = std::upper_bound(
+      m_runs.begin(), m_runs.end(), sample,
+      [](int64_t s, const TimecodeIndexRun& r) { return s < r.sample; });
+  if(it == m_runs.begin())
+    return nullptr;
+
+  const auto& r = *std::prev(it);
+  return sample < r.sample + r.length ? &r : nullptr;
+}
+
+std::optional<double> TimecodeIndex::timecode(int64_t sample) const noexcept
+{
+  if(auto r = find(sample))
+    return r->seconds + r->speed * (sample - r->sample) / rate();
+  return std::nullopt;
+}
+
+std::optional<int64_t> TimecodeIndex::sample(double seconds) const noexcept
+{
+  const double sr = rate();
+
+  // Last run starting at or before the time code. The previous ones can only
+  // contain it as long as the running maximum of their ends goes past it, which is
+  // rarely more than a couple of runs unless the recording rewinds a lot.
+  auto it = std::upper_bound(
+      m_order.begin(), m_order.end(), seconds,
+      [&](double t, uint32_t i) { return t < run_begin(m_runs[i], sr); });
+
+  std::optional<int64_t> found;
+  for(auto i = std::distance(m_order.begin(), it) - 1;
+      i >= 0 && m_max_end[i] >= seconds; i--)
+  {
+    const auto& r = m_runs[m_order[i]];
+    if(r.speed == 0.)
+      continue;
+
+    const auto offset
+        = static_cast<int64_t>(std::floor((seconds - r.seconds) / r.speed * sr));
+    if(offset < 0 || offset >= r.length)
+      continue;
+    if(!found || r.sample + offset < *found)
+      found = r.sample + offset;
+  }
+  return found;
+}
+}
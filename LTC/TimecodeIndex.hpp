@@ -0,0 +1,73 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "TimecodeMath.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace ao
+{
+/**
+ * @brief Samples of a recording where the time code advances at a constant speed
+ *
+ * The run covers [sample; sample + length), and is at `seconds` on its first sample.
+ * fps is 0 for DVS timecode, which has no frames.
+ */
+struct TimecodeIndexRun
+{
+  int64_t sample;
+  int64_t length;
+  double seconds;
+  double speed;
+  float fps;
+  uint8_t drop_frame;
+  uint8_t padding[3];
+};
+static_assert(sizeof(TimecodeIndexRun) == 40);
+
+/**
+ * @brief Sample <-> time code map of a recording, from a memory-mapped file
+ *
+ * The file is the header, the runs sorted by sample, then the order of the runs by
+ * start time code along with the running maximum of their end time code. Both
+ * lookups are binary searches: seeking to a time code does not need to decode
+ * anything again. The file is in the byte order of the machine that wrote it.
+ *
+ * open() does not copy: the data must outlive the index.
+ */
+class TimecodeIndex
+{
+public:
+  // Runs sorted by sample
+  static std::vector<std::byte>
+  build(double rate, std::span<const TimecodeIndexRun> runs);
+
+  // Returns false if the data is not a valid index
+  bool open(const void* data, std::size_t size) noexcept;
+
+  double rate() const noexcept;
+  std::span<const TimecodeIndexRun> runs() const noexcept { return m_runs; }
+
+  // The run containing the sample, if any
+  const TimecodeIndexRun* find(int64_t sample) const noexcept;
+
+  // Time code at a sample of the recording
+  std::optional<double> timecode(int64_t sample) const noexcept;
+
+  // First sample of the recording at a time code
+  std::optional<int64_t> sample(double seconds) const noexcept;
+
+private:
+  struct header;
+
+  const header* m_header{};
+  std::span<const TimecodeIndexRun> m_runs;
+  std::span<const uint32_t> m_order;
+  std::span<const double> m_max_end;
+};
+}
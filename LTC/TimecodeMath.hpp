@@ -0,0 +1,155 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <cstdint>
+
+namespace ao
+{
+// Units the time codes are output in
+enum class TimeFormat
+{
+  Seconds,
+  Milliseconds,
+  Microseconds,
+  Nanoseconds,
+  Flicks
+};
+
+// One second in each TimeFormat
+inline constexpr int64_t time_units_per_second[]{
+    1, 1'000, 1'000'000, 1'000'000'000, 705'600'000};
+
+constexpr double to_time_format(double seconds, TimeFormat format) noexcept
+{
+  return seconds * double(time_units_per_second[int(format)]);
+}
+
+// Exact in every unit but seconds, which all are multiples of a millisecond
+constexpr double milliseconds_to_time_format(int64_t ms, TimeFormat format) noexcept
+{
+  if(format == TimeFormat::Seconds)
+    return double(ms) / 1000.;
+  return double(ms * (time_units_per_second[int(format)] / 1000));
+}
+
+/**
+ * @brief Frame rate of a time code, as a ratio: 29.97 is 30000 / 1001
+ *
+ * Drop-frame time codes skip the first frame numbers of every minute but the
+ * tenths, so that their labels follow the clock: 2 at 29.97 frames per second.
+ */
+struct TimecodeRate
+{
+  int32_t num{30};
+  int32_t den{1};
+  bool drop_frame{false};
+
+  // Frame numbers in a second of the labels: 30 at 29.97
+  constexpr int nominal() const noexcept { return (num + den - 1) / den; }
+  constexpr double fps() const noexcept { return double(num) / den; }
+
+  friend constexpr bool operator==(TimecodeRate, TimecodeRate) noexcept = default;
+};
+
+inline constexpr TimecodeRate timecode_rate_24{24, 1};
+inline constexpr TimecodeRate timecode_rate_25{25, 1};
+inline constexpr TimecodeRate timecode_rate_2997{30000, 1001};
+inline constexpr TimecodeRate timecode_rate_2997_drop{30000, 1001, true};
+inline constexpr TimecodeRate timecode_rate_30{30, 1};
+
+// Rate of LTC frames with the drop-frame flag, of which the highest frame number
+// seen so far is max_frame: until it is the highest of the rate, the rate is
+// underestimated
+constexpr TimecodeRate detect_timecode_rate(bool drop_frame, int max_frame) noexcept
+{
+  if(drop_frame)
+    return timecode_rate_2997_drop;
+  if(max_frame >= 25)
+    return timecode_rate_30;
+  if(max_frame >= 24)
+    return timecode_rate_25;
+  return timecode_rate_24;
+}
+
+// Frames since 00:00:00:00 of a time code
+constexpr int64_t
+timecode_frames(int hours, int mins, int secs, int frame, TimecodeRate rate) noexcept
+{
+  const int64_t nominal = rate.nominal();
+  const int64_t minutes = int64_t(hours) * 60 + mins;
+  int64_t frames = (minutes * 60 + secs) * nominal + frame;
+  if(rate.drop_frame)
+    frames -= (nominal / 15) * (minutes - minutes / 10);
+  return frames;
+}
+
+// Labels of a time code, hours within a day
+struct TimecodeLabels
+{
+  int hours, mins, secs, frame;
+
+  friend constexpr bool operator==(TimecodeLabels, TimecodeLabels) noexcept = default;
+};
+
+// Inverse of timecode_frames, for frames from 00:00:00:00 on
+constexpr TimecodeLabels timecode_labels(int64_t frames, TimecodeRate rate) noexcept
+{
+  const int64_t nominal = rate.nominal();
+  if(rate.drop_frame)
+  {
+    // Put back the numbers dropped before the frame
+    const int64_t dropped = nominal / 15;
+    const int64_t per_minute = nominal * 60 - dropped;
+    const int64_t per_ten_minutes = nominal * 600 - 9 * dropped;
+    const int64_t tens = frames / per_ten_minutes;
+    const int64_t rest = frames % per_ten_minutes;
+    frames += 9 * dropped * tens;
+    if(rest >= dropped)
+      frames += dropped * ((rest - dropped) / per_minute);
+  }
+
+  const int64_t secs = frames / nominal;
+  return {
+      int(secs / 3600 % 24), int(secs / 60 % 60), int(secs % 60), int(frames % nominal)};
+}
+
+constexpr double frames_to_seconds(int64_t frames, TimecodeRate rate) noexcept
+{
+  return double(frames * rate.den) / rate.num;
+}
+
+// Start of a frame in a format: exact in flicks, to the nearest unit otherwise.
+// This does not overflow for three days of frames at 29.97 in nanoseconds.
+constexpr double
+frames_to_time_format(int64_t frames, TimecodeRate rate, TimeFormat format) noexcept
+{
+  if(format == TimeFormat::Seconds)
+    return frames_to_seconds(frames, rate);
+
+  const int64_t units = frames * rate.den * time_units_per_second[int(format)];
+  return double((units + rate.num / 2) / rate.num);
+}
+
+// Seconds of an SMPTE time code at the start of its frame, as the LTC processes
+// output them
+constexpr double
+timecode_seconds(int hours, int mins, int secs, int frame, TimecodeRate rate) noexcept
+{
+  return frames_to_seconds(timecode_frames(hours, mins, secs, frame, rate), rate);
+}
+
+static_assert(timecode_frames(1, 0, 0, 0, timecode_rate_25) == 90'000);
+static_assert(timecode_frames(0, 1, 0, 2, timecode_rate_2997_drop) == 1'800);
+static_assert(timecode_frames(0, 10, 0, 0, timecode_rate_2997_drop) == 17'982);
+static_assert(timecode_frames(1, 0, 0, 0, timecode_rate_2997_drop) == 107'892);
+static_assert(
+    timecode_labels(1'799, timecode_rate_2997_drop) == TimecodeLabels{0, 0, 59, 29});
+static_assert(
+    timecode_labels(1'800, timecode_rate_2997_drop) == TimecodeLabels{0, 1, 0, 2});
+static_assert(
+    timecode_labels(17'982, timecode_rate_2997_drop) == TimecodeLabels{0, 10, 0, 0});
+static_assert(timecode_labels(90'001, timecode_rate_25) == TimecodeLabels{1, 0, 0, 1});
+static_assert(frames_to_time_format(1, timecode_rate_2997, TimeFormat::Flicks) == 23'543'520);
+static_assert(frames_to_time_format(3, timecode_rate_2997, TimeFormat::Nanoseconds) == 100'100'000);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+namespace ao
+{
+/**
+ * @brief State of a time code decoder at the end of a block
+ *
+ * seconds is the time code at `sample`, the count of samples the process has
+ * received, and at `steady_ns`, the std::chrono::steady_clock time it was
+ * published at.
+ */
+struct TimecodeSnapshot
+{
+  double seconds;
+  double speed;
+  int64_t sample;
+  int64_t steady_ns;
+  bool valid;
+  uint8_t padding[7];
+
+  static int64_t now_ns() noexcept
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  // The time code at a steady_clock time, at the speed of the snapshot
+  double extrapolate(int64_t at_ns) const noexcept
+  {
+    return seconds + speed * double(at_ns - steady_ns) * 1e-9;
+  }
+};
+static_assert(sizeof(TimecodeSnapshot) == 40);
+
+/**
+ * @brief Latest TimecodeSnapshot of a decoder, for any number of other threads
+ *
+ * A sequence lock: the audio thread publishes after every block without waiting,
+ * readers copy the snapshot and check that it was not being written meanwhile.
+ * A read gives up after a few such races instead of spinning, so it is wait-free
+ * too: with one publication per block, they are rare.
+ */
+class TimecodePublisher
+{
+public:
+  // Audio thread only
+  void publish(const TimecodeSnapshot& s) noexcept
+  {
+    const auto w = std::bit_cast<words>(s);
+    const auto seq = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for(std::size_t i = 0; i < w.size(); i++)
+      m_words[i].store(w[i], std::memory_order_relaxed);
+    m_sequence.store(seq + 2, std::memory_order_release);
+  }
+
+  // Returns false if nothing was published yet, or if the snapshot was being
+  // written on every try
+  bool read(TimecodeSnapshot& out) const noexcept
+  {
+    for(int attempt = 0; attempt < attempts; attempt++)
+    {
+      const auto before = m_sequence.load(std::memory_order_acquire);
+      if(before & 1)
+        continue;
+
+      words w;
+      for(std::size_t i = 0; i < w.size(); i++)
+        w[i] = m_words[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      if(m_sequence.load(std::memory_order_relaxed) == before)
+      {
+        out = std::bit_cast<TimecodeSnapshot>(w);
+        return before != 0;
+      }
+    }
+    return false;
+  }
+
+private:
+  using words = std::array<uint64_t, sizeof(TimecodeSnapshot) / sizeof(uint64_t)>;
+  static constexpr int attempts = 4;
+
+  alignas(64) std::atomic<uint32_t> m_sequence{0};
+  std::array<std::atomic<uint64_t>, std::tuple_size_v<words>> m_words{};
+};
+}
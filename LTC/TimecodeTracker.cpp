@@ -0,0 +1,118 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "TimecodeTracker.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ao
+{
+
+// Jitter of the start of the frames found by the decoder, in samples
+static constexpr double start_jitter = 4.;
+
+// Frames to agree with the prediction before locking, and the bound of their
+// average normalised innovation, in variance
+static constexpr int lock_frames = 8;
+static constexpr double lock_nis = 9.;
+
+void TimecodeTracker::reset(double sample_rate) noexcept
+{
+  m_rate = sample_rate;
+  m_sample = 0;
+  m_x[0] = 0.;
+  m_x[1] = 0.;
+  m_frames = 0;
+  m_nis = 0.;
+  m_tracking = false;
+}
+
+void TimecodeTracker::set_bandwidth(double hz) noexcept
+{
+  m_omega = 2. * std::numbers::pi * std::max(hz, 0.01);
+}
+
+bool TimecodeTracker::locked() const noexcept
+{
+  return m_tracking && m_frames >= lock_frames && m_nis < lock_nis;
+}
+
+void TimecodeTracker::restart(int64_t sample, double position, double speed) noexcept
+{
+  m_sample = sample;
+  m_x[0] = position;
+  m_x[1] = speed;
+
+  // The position is that of the frame, the speed only comes from its length
+  const double r = start_jitter / m_rate;
+  m_p[0][0] = r * r;
+  m_p[0][1] = 0.;
+  m_p[1][0] = 0.;
+  m_p[1][1] = 0.01;
+
+  m_frames = 0;
+  m_nis = 0.;
+  m_tracking = true;
+}
+
+void TimecodeTracker::observe(int64_t sample, double position, double speed) noexcept
+{
+  if(!m_tracking || m_rate <= 0.)
+  {
+    restart(sample, position, speed);
+    return;
+  }
+
+  const double dt = (sample - m_sample) / m_rate;
+  if(dt <= 0.)
+  {
+    restart(sample, position, speed);
+    return;
+  }
+
+  // Predict: x' = F x, P' = F P F^T + Q with F = [1 dt; 0 1]
+  const double x0 = m_x[0] + m_x[1] * dt;
+  const double x1 = m_x[1];
+
+  // In steady state the loop has a natural frequency of (q / (r^2 dt))^(1/4)
+  const double r = start_jitter / m_rate;
+  const double omega2 = m_omega * m_omega;
+  const double q = omega2 * omega2 * r * r * dt;
+  const double p00 = m_p[0][0] + dt * (m_p[1][0] + m_p[0][1]) + dt * dt * m_p[1][1]
+                     + q * dt * dt * dt / 3.;
+  const double p01 = m_p[0][1] + dt * m_p[1][1] + q * dt * dt / 2.;
+  const double p10 = m_p[1][0] + dt * m_p[1][1] + q * dt * dt / 2.;
+  const double p11 = m_p[1][1] + q * dt;
+
+  const double innovation = position - x0;
+  if(std::abs(innovation) > max_error)
+  {
+    restart(sample, position, speed);
+    return;
+  }
+
+  // Update with the position: H = [1 0]
+  const double s = p00 + r * r;
+  const double k0 = p00 / s;
+  const double k1 = p10 / s;
+
+  m_x[0] = x0 + k0 * innovation;
+  m_x[1] = x1 + k1 * innovation;
+
+  m_p[0][0] = (1. - k0) * p00;
+  m_p[0][1] = (1. - k0) * p01;
+  m_p[1][0] = p10 - k1 * p00;
+  m_p[1][1] = p11 - k1 * p01;
+
+  m_sample = sample;
+
+  const double nis = innovation * innovation / s;
+  m_nis = m_frames == 0 ? nis : m_nis + 0.1 * (nis - m_nis);
+  m_frames++;
+}
+
+double TimecodeTracker::position(int64_t sample) const noexcept
+{
+  return m_x[0] + m_x[1] * (sample - m_sample) / m_rate;
+}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <cstdint>
+#include <numbers>
+
+namespace ao
+{
+/**
+ * @brief Continuous position from the frames of a decoded time code
+ *
+ * Decoded frames give the position every 1/24 to 1/30 s, at the sample where
+ * the frame starts. A constant velocity Kalman filter, as xwax's pitch_kalman,
+ * smooths them into a position and a speed, which are then extrapolated to any
+ * sample in between.
+ *
+ * A frame too far from the prediction is a jump of the source: the filter
+ * restarts from it.
+ *
+ * The filter behaves as a second order PLL whose natural frequency is the
+ * bandwidth: the process noise is derived from it and the measurement noise.
+ * It is locked once enough frames agree with the prediction, as measured by the
+ * normalised innovation.
+ */
+class TimecodeTracker
+{
+public:
+  // Beyond this, in seconds, a frame is a jump rather than jitter
+  static constexpr double max_error = 0.1;
+
+  static constexpr double default_bandwidth = 2.;
+
+  void reset(double sample_rate) noexcept;
+
+  // In Hz: lower is smoother, higher follows speed changes faster
+  void set_bandwidth(double hz) noexcept;
+
+  // A frame starting at the given input sample, at the given position in seconds.
+  // speed is the one measured from the length of the frame, used when restarting.
+  void observe(int64_t sample, double position, double speed) noexcept;
+
+  bool tracking() const noexcept { return m_tracking; }
+  bool locked() const noexcept;
+
+  // Position in seconds at the given input sample
+  double position(int64_t sample) const noexcept;
+
+  // Seconds of time code per second of input
+  double speed() const noexcept { return m_x[1]; }
+
+private:
+  void restart(int64_t sample, double position, double speed) noexcept;
+
+  double m_rate{};
+  int64_t m_sample{};
+
+  // Position (s) and speed state, and their covariance
+  double m_x[2]{};
+  double m_p[2][2]{};
+
+  // Natural frequency, rad/s
+  double m_omega{2. * std::numbers::pi * default_bandwidth};
+
+  // Frames since the last restart, and average of their squared normalised
+  // innovation
+  int m_frames{};
+  double m_nis{};
+
+  bool m_tracking{};
+};
+}
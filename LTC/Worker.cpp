@@ -0,0 +1,92 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "Worker.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace ao
+{
+
+Worker& Worker::instance()
+{
+  static Worker worker;
+  return worker;
+}
+
+Worker::Worker()
+    : m_thread{[this] { run(); }}
+{
+}
+
+Worker::~Worker()
+{
+  {
+    std::lock_guard lock{m_mutex};
+    m_stop = true;
+  }
+  m_cv.notify_one();
+  m_thread.join();
+}
+
+int Worker::add(task t)
+{
+  std::lock_guard lock{m_mutex};
+  const int id = m_next_id++;
+  m_tasks.emplace_back(id, std::move(t));
+  return id;
+}
+
+void Worker::remove(int id)
+{
+  std::unique_lock lock{m_mutex};
+  m_done.wait(lock, [this, id] { return m_running != id; });
+  std::erase_if(m_tasks, [id](const auto& t) { return t.first == id; });
+}
+
+void Worker::wake() noexcept
+{
+  m_pending.store(true, std::memory_order_release);
+  m_cv.notify_one();
+}
+
+void Worker::run()
+{
+  using namespace std::chrono_literals;
+
+  std::unique_lock lock{m_mutex};
+  while(!m_stop)
+  {
+    // wake() does not take the mutex, so a notification can be missed:
+    // the timeout bounds the latency in that case.
+    m_cv.wait_for(lock, 100ms, [this] {
+      return m_stop || m_pending.load(std::memory_order_acquire);
+    });
+    if(m_stop)
+      break;
+
+    if(!m_pending.exchange(false, std::memory_order_acq_rel))
+      continue;
+
+    // Tasks added during the pass run in it too, those removed do not
+    for(int last = -1;;)
+    {
+      auto it = std::find_if(
+          m_tasks.begin(), m_tasks.end(), [last](const auto& t) { return t.first > last; });
+      if(it == m_tasks.end())
+        break;
+
+      // remove() does not erase the task while it runs
+      last = m_running = it->first;
+      lock.unlock();
+      it->second();
+      lock.lock();
+      m_running = -1;
+      m_done.notify_all();
+
+      if(m_stop)
+        break;
+    }
+  }
+}
+}
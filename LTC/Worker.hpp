@@ -0,0 +1,62 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace ao
+{
+/**
+ * @brief Shared background thread for work that must not run on the audio thread
+ *
+ * Processors register a polling task from a non real-time context (usually their
+ * constructor) and unregister it in their destructor. The audio thread only ever
+ * calls wake(), which neither allocates nor blocks: the worker then runs every
+ * registered task, which checks its own atomic state to see if there is work to do.
+ *
+ * Tasks run with the lock released: a task building a lookup table for seconds
+ * does not delay add() or remove() of the others.
+ */
+class Worker
+{
+public:
+  using task = std::function<void()>;
+
+  static Worker& instance();
+
+  // Returns an identifier to pass to remove()
+  int add(task t);
+
+  // Blocks until the task is guaranteed to not be running anymore: only waits
+  // if that very task is running
+  void remove(int id);
+
+  // Real-time safe
+  void wake() noexcept;
+
+private:
+  Worker();
+  ~Worker();
+  void run();
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  // Notified when a task is done running, for remove()
+  std::condition_variable m_done;
+  // A list, so that the running task stays in place while others come and go.
+  // Sorted by identifier.
+  std::list<std::pair<int, task>> m_tasks;
+  std::atomic_bool m_pending{false};
+  bool m_stop{false};
+  int m_next_id{0};
+  int m_running{-1};
+
+  std::thread m_thread;
+};
+}
@@ -0,0 +1,137 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ao
+{
+
+// With the audio thread, enough for four decks
+static constexpr int max_threads = 3;
+
+// Checks of a batch in flight before the audio thread sleeps until it is done
+static constexpr int spins = 1024;
+
+// As far as permitted: without the rights for it, the threads keep their priority.
+// The middle of the range leaves room above for the audio threads of most hosts.
+static void set_realtime_priority() noexcept
+{
+#if defined(_WIN32)
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+#elif defined(__unix__) || defined(__APPLE__)
+  sched_param param{};
+  param.sched_priority
+      = (sched_get_priority_min(SCHED_FIFO) + sched_get_priority_max(SCHED_FIFO)) / 2;
+  pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+#endif
+}
+
+WorkerPool& WorkerPool::instance()
+{
+  static WorkerPool pool;
+  return pool;
+}
+
+WorkerPool::WorkerPool()
+{
+  const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+  const int n = std::clamp(hardware - 1, 0, max_threads);
+  for(int i = 0; i < n; i++)
+    m_threads.emplace_back([this] { loop(); });
+}
+
+WorkerPool::~WorkerPool()
+{
+  m_stop.store(true, std::memory_order_release);
+  m_wake.fetch_add(1, std::memory_order_release);
+  m_wake.notify_all();
+  for(auto& t : m_threads)
+    t.join();
+}
+
+void WorkerPool::loop()
+{
+  set_realtime_priority();
+
+  uint32_t seen = m_wake.load(std::memory_order_acquire);
+  for(;;)
+  {
+    m_wake.wait(seen, std::memory_order_acquire);
+    seen = m_wake.load(std::memory_order_acquire);
+    if(m_stop.load(std::memory_order_acquire))
+      break;
+    work();
+  }
+}
+
+void WorkerPool::work() noexcept
+{
+  uint64_t batch = m_batch.load(std::memory_order_acquire);
+  for(;;)
+  {
+    const auto next = static_cast<int>((batch >> 16) & 0xFFFF);
+    const auto count = static_cast<int>(batch & 0xFFFF);
+    if(next >= count)
+      return;
+
+    // These may already be those of a later batch: then the claim fails
+    const job j = m_job.load(std::memory_order_relaxed);
+    void* const context = m_context.load(std::memory_order_relaxed);
+    if(m_batch.compare_exchange_weak(
+           batch, batch + (1 << 16), std::memory_order_acq_rel,
+           std::memory_order_acquire))
+    {
+      j(context, next);
+      if(m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        m_remaining.notify_all();
+      batch = m_batch.load(std::memory_order_acquire);
+    }
+  }
+}
+
+void WorkerPool::run(job j, void* context, int count) noexcept
+{
+  if(count <= 0)
+    return;
+
+  if(m_threads.empty() || count == 1 || count > 0xFFFF
+     || m_busy.test_and_set(std::memory_order_acquire))
+  {
+    for(int i = 0; i < count; i++)
+      j(context, i);
+    return;
+  }
+
+  m_job.store(j, std::memory_order_relaxed);
+  m_context.store(context, std::memory_order_relaxed);
+  m_remaining.store(count, std::memory_order_relaxed);
+
+  const uint64_t number = (m_batch.load(std::memory_order_relaxed) >> 32) + 1;
+  m_batch.store((number << 32) | static_cast<uint64_t>(count), std::memory_order_release);
+
+  m_wake.fetch_add(1, std::memory_order_release);
+  m_wake.notify_all();
+
+  work();
+
+  // Only jobs which another thread is running are left
+  for(int i = 0;; i++)
+  {
+    const int remaining = m_remaining.load(std::memory_order_acquire);
+    if(remaining == 0)
+      break;
+    if(i >= spins)
+      m_remaining.wait(remaining, std::memory_order_acquire);
+  }
+
+  m_busy.clear(std::memory_order_release);
+}
+}
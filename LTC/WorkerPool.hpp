@@ -0,0 +1,60 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace ao
+{
+/**
+ * @brief Small pool of real-time priority threads to split a tick across cores
+ *
+ * Unlike Worker, which is for work that must stay off the audio thread, this is
+ * for work of the audio thread itself, which is independent enough to run in
+ * parallel: the audio thread hands out a batch of jobs and takes part in it.
+ *
+ * Jobs are claimed one at a time from the batch by whichever thread is free, so
+ * a thread which is late or preempted leaves its share to the others. The audio
+ * thread runs whatever is left and only waits for the jobs in flight: with no
+ * pool thread available, a batch runs serially on the audio thread.
+ */
+class WorkerPool
+{
+public:
+  using job = void (*)(void* context, int index);
+
+  static WorkerPool& instance();
+
+  // Runs j(context, i) for every i in [0, count), returns when they are all done.
+  // Does not allocate. If another thread is running a batch, this one runs on
+  // the calling thread only.
+  void run(job j, void* context, int count) noexcept;
+
+  int threads() const noexcept { return static_cast<int>(m_threads.size()); }
+
+private:
+  WorkerPool();
+  ~WorkerPool();
+  void loop();
+
+  // Runs jobs of the current batch until none is left to claim
+  void work() noexcept;
+
+  // Batch number, next job to claim and number of jobs, as one word so that a
+  // job is never claimed from a batch which has already been replaced:
+  // 32 bits of batch, 16 of next job, 16 of count
+  std::atomic<uint64_t> m_batch{0};
+  std::atomic<job> m_job{nullptr};
+  std::atomic<void*> m_context{nullptr};
+  std::atomic_int m_remaining{0};
+
+  std::atomic_flag m_busy;
+  std::atomic<uint32_t> m_wake{0};
+  std::atomic_bool m_stop{false};
+
+  std::vector<std::thread> m_threads;
+};
+}
@@ -2,49 +2,65 @@
 
 #include "XWax.hpp"
 
+#include "Worker.hpp"
+#include "XWaxDefinitions.hpp"
+
 #include <cmath>
 #include <timecoder.h>
 
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
-#include <numeric>
 namespace ao
 {
 
-// Timecode format name mapping
-static constexpr const char* timecode_names[] = {
-    "serato_2a",      // Serato_2a
-    "serato_2b",      // Serato_2b
-    "serato_cd",      // Serato_CD
-    "traktor_a",      // Traktor_A
-    "traktor_b",      // Traktor_B
-    "traktor_mk2_a",  // Traktor_MK2_A
-    "traktor_mk2_b",  // Traktor_MK2_B
-    "traktor_mk2_cd", // Traktor_MK2_CD
-    "mixvibes_v2",    // MixVibes_V2
-    "mixvibes_7inch", // MixVibes_7inch
-    "pioneer_a",      // Pioneer_A
-    "pioneer_b",      // Pioneer_B
-};
+static_assert(int(XWaxDVS::Kalman) == TIMECODER_PITCH_KALMAN);
+static_assert(int(XWaxDVS::AlphaBeta) == TIMECODER_PITCH_ALPHA_BETA);
+static_assert(int(XWaxDVS::KalmanFast) == TIMECODER_PITCH_KALMAN_FAST);
+
+// Mean of the squares of both channels of a block. The four independent sums let
+// the loop vectorise without -ffast-math.
+static double block_energy(const double* left, const double* right, int n) noexcept
+{
+  double s[4]{};
+  int i = 0;
+  for(; i + 4 <= n; i += 4)
+  {
+    for(int k = 0; k < 4; k++)
+      s[k] += left[i + k] * left[i + k] + right[i + k] * right[i + k];
+  }
+  for(; i < n; i++)
+    s[0] += left[i] * left[i] + right[i] * right[i];
+
+  return (s[0] + s[1] + s[2] + s[3]) / (2. * n);
+}
 
 XWaxDVS::XWaxDVS()
+    : m_request{std::make_shared<XWaxDefinitionRequest>()}
+    , m_scope_ring{std::make_shared<ScopeRing>()}
+    , m_publisher{std::make_shared<TimecodePublisher>()}
 {
   m_timecoder = new timecoder{};
+  m_scope = new timecoder_scope{};
+  m_scope->x = m_scope_x.data();
+  m_scope->y = m_scope_y.data();
+  m_scope->capacity = scope_points;
+
+  XWaxDefinitions::init();
+  m_worker_task = Worker::instance().add([req = m_request] { req->process(); });
 }
 
 XWaxDVS::~XWaxDVS()
 {
+  Worker::instance().remove(m_worker_task);
   clear_timecoder();
   delete m_timecoder;
+  delete m_scope;
 }
 
-const char* XWaxDVS::get_timecode_name() const
+void XWaxDVS::prewarm(bool enable)
 {
-  const int idx = static_cast<int>(inputs.vinyl_type.value);
-  if(idx >= 0 && idx < static_cast<int>(std::size(timecode_names)))
-    return timecode_names[idx];
-  return timecode_names[0]; // Default to Serato 2a
+  m_prewarm.set(enable);
 }
 
 double XWaxDVS::get_speed_multiplier() const
@@ -57,41 +73,38 @@ void XWaxDVS::clear_timecoder()
 {
   if(m_initialized && m_timecoder)
   {
-    if(m_timecoder->mon)
-    {
-      timecoder_monitor_clear(m_timecoder);
-    }
     timecoder_clear(m_timecoder);
     m_initialized = false;
   }
-  m_timecode_def = nullptr;
+}
+
+// Without a scope, the timecoder runs a decoding loop which has no scope code
+void XWaxDVS::update_scope() noexcept
+{
+  const bool attached = m_timecoder->scope != nullptr;
+  if(inputs.scope && !attached)
+  {
+    m_scope->count = 0;
+    timecoder_scope_attach(m_timecoder, m_scope);
+  }
+  else if(!inputs.scope && attached)
+  {
+    timecoder_scope_attach(m_timecoder, nullptr);
+  }
 }
 
 void XWaxDVS::init_timecoder()
 {
   clear_timecoder();
 
-  if(m_setup.rate <= 0)
+  if(m_setup.rate <= 0 || !m_timecode_def)
     return;
 
-  const char* timecode_name = get_timecode_name();
   const double speed = get_speed_multiplier();
 
-  // Use legacy pitch filter if AlphaBeta is selected
-  using filter_type = std::decay_t<decltype(inputs.pitch_filter.value)>;
-  const bool use_legacy_pitch = (inputs.pitch_filter.value == static_cast<filter_type>(1));
-
-  // Find the timecode definition (this builds the LUT if needed)
-  // Pass nullptr for lut_dir_path - xwax will use default or skip caching
-  m_timecode_def = timecoder_find_definition(timecode_name, nullptr);
-
-  if(!m_timecode_def)
-  {
-    // Fallback to serato_2a if the requested format fails
-    m_timecode_def = timecoder_find_definition("serato_2a", nullptr);
-    if(!m_timecode_def)
-      return; // Give up if even the default fails
-  }
+  // The filters are in the order of the timecoder's
+  const auto pitch_filter
+      = static_cast<timecoder_pitch_filter>(inputs.pitch_filter.value);
 
   // Initialize the timecoder
   timecoder_init(
@@ -100,47 +113,74 @@ void XWaxDVS::init_timecoder()
       speed,
       static_cast<unsigned int>(m_setup.rate),
       false, // Not phono level (line level)
-      use_legacy_pitch);
+      pitch_filter);
 
   m_initialized = true;
-
-  // Reset quality tracking
-  std::fill(std::begin(m_quality_ring), std::end(m_quality_ring), 0);
-  m_quality_ring_index = 0;
-  m_quality_ring_filled = 0;
-  m_quality_last_position = -1;
-  m_quality_last_pitch = 0.0;
+  m_stats.count_reinit();
 }
 
 void XWaxDVS::prepare(halp::setup setup)
 {
   m_setup = setup;
 
-  // Pre-allocate work buffer for a reasonable buffer size
-  // This will be resized if needed during processing
-  m_work_buffer.reserve(4096);
+  // About as many points as the xwax monitor got at 12 kHz, within the buffer
+  const int by_rate = static_cast<int>(setup.rate / 12000.);
+  const int by_block = (setup.frames + scope_points - 1) / scope_points;
+  m_scope->decimation = static_cast<unsigned int>(std::max({1, by_rate, by_block}));
 
   // Force reinitialization on next process call
   m_last_vinyl_type = -1;
   m_last_speed = -1;
   m_last_pitch_filter = -1;
+  m_last_timecode_def = nullptr;
+
+  m_gate_open = true;
+  m_gate_quiet = 0;
+  m_sample_position = 0;
+
+  if(inputs.prewarm)
+    prewarm(true);
 }
 
 void XWaxDVS::operator()(halp::tick_flicks tk)
 {
   const int frames = tk.frames;
+  m_sample_position += std::max(frames, 0);
 
-  // Check if we need to reinitialize the timecoder due to parameter changes
+  // Also the ticks which wait for a lookup table
+  auto timer = m_stats.time_tick(frames, m_setup.rate);
+
+  // A vinyl type change requires a new lookup table: ask the worker thread for it
+  // and keep decoding with the current timecoder until it is ready
   const int current_vinyl_type = static_cast<int>(inputs.vinyl_type.value);
+  if(current_vinyl_type != m_last_vinyl_type)
+  {
+    m_request->requested.store(current_vinyl_type, std::memory_order_release);
+    Worker::instance().wake();
+    m_last_vinyl_type = current_vinyl_type;
+  }
+
+  // Adopt the definition published by the worker, and acknowledge it so that the
+  // worker can release the previous one
+  if(auto def = m_request->published.load(std::memory_order_acquire);
+     def != m_timecode_def)
+  {
+    m_timecode_def = def;
+    m_request->in_use.store(def, std::memory_order_release);
+    Worker::instance().wake();
+    m_stats.set_lut_build_time(m_request->load_ns.load(std::memory_order_relaxed));
+  }
+
+  // Check if we need to reinitialize the timecoder due to parameter changes
   const int current_speed = static_cast<int>(inputs.speed.value);
   const int current_pitch_filter = static_cast<int>(inputs.pitch_filter.value);
 
-  if(current_vinyl_type != m_last_vinyl_type ||
+  if(m_timecode_def != m_last_timecode_def ||
      current_speed != m_last_speed ||
      current_pitch_filter != m_last_pitch_filter)
   {
     init_timecoder();
-    m_last_vinyl_type = current_vinyl_type;
+    m_last_timecode_def = m_timecode_def;
     m_last_speed = current_speed;
     m_last_pitch_filter = current_pitch_filter;
   }
@@ -148,12 +188,7 @@ void XWaxDVS::operator()(halp::tick_flicks tk)
   // Cannot process without a valid timecoder
   if(!m_initialized || !m_timecoder)
   {
-    outputs.speed = 0.0;
-    outputs.tempo = 0.0;
-    outputs.position = 0.0;
-    outputs.timecode = -1;
-    outputs.quality = 0.0;
-    outputs.valid = false;
+    output_invalid(timer);
     return;
   }
 
@@ -161,48 +196,32 @@ void XWaxDVS::operator()(halp::tick_flicks tk)
   const int channels = inputs.audio.channels;
   if(channels < 2 || frames <= 0)
   {
-    outputs.speed = 0.0;
-    outputs.tempo = 0.0;
-    outputs.position = 0.0;
-    outputs.timecode = -1;
-    outputs.quality = 0.0;
-    outputs.valid = false;
+    output_invalid(timer);
     return;
   }
 
-  // Resize work buffer if needed (stereo interleaved)
-  const size_t required_size = static_cast<size_t>(frames) * 2;
-  if(m_work_buffer.size() < required_size)
+  // The timecoder is left as it is, for when the signal comes back
+  if(!update_gate(frames))
   {
-    m_work_buffer.resize(required_size);
+    output_invalid(timer);
+    return;
   }
 
-  // Get channel pointers
+  // Submit the planar channels to xwax as they are: they are scaled to its
+  // 32-bit input range block by block, without losing resolution
+  update_scope();
   auto left_channel = inputs.audio.channel(0, frames);
   auto right_channel = inputs.audio.channel(1, frames);
+  timecoder_submit_double(
+      m_timecoder, left_channel.data(), right_channel.data(),
+      static_cast<size_t>(frames));
 
-  // Convert double samples to signed 16-bit shorts (interleaved stereo)
-  // xwax expects samples in the full range of signed short (-32768 to 32767)
-  constexpr double SAMPLE_SCALE = 32767.0;
-
-  for(int i = 0; i < frames; ++i)
+  if(m_timecoder->scope)
   {
-    // Get samples and scale to 16-bit range
-    double left_sample = left_channel[i] * SAMPLE_SCALE;
-    double right_sample = right_channel[i] * SAMPLE_SCALE;
-
-    // Clamp to valid range
-    left_sample = std::clamp(left_sample, -32768.0, 32767.0);
-    right_sample = std::clamp(right_sample, -32768.0, 32767.0);
-
-    // Interleave into work buffer
-    m_work_buffer[i * 2] = static_cast<signed short>(left_sample);
-    m_work_buffer[i * 2 + 1] = static_cast<signed short>(right_sample);
+    m_scope_ring->push(m_scope_x.data(), m_scope_y.data(), m_scope->count);
+    m_scope->count = 0;
   }
 
-  // Submit samples to xwax timecoder
-  timecoder_submit(m_timecoder, m_work_buffer.data(), static_cast<size_t>(frames));
-
   // Get pitch (speed) from the timecoder
   const double pitch = timecoder_get_pitch(m_timecoder);
   outputs.speed = pitch;
@@ -212,13 +231,18 @@ void XWaxDVS::operator()(halp::tick_flicks tk)
   double when = 0.0;
   const signed int position_ms = timecoder_get_position(m_timecoder, &when);
 
+  if(position_ms >= 0)
+    m_stats.count_decoded();
+  else if(outputs.valid)
+    m_stats.count_dropped();
+
   if(position_ms >= 0)
   {
-    // Valid position - convert from milliseconds to seconds and apply lead-in offset
-    const double position_sec = static_cast<double>(position_ms) / 1000.0;
-    const double leadin_sec = static_cast<double>(inputs.leadin.value);
-    outputs.position = this->convert_output(position_sec - leadin_sec);
-    outputs.timecode = this->convert_output(position_sec);
+    // Valid position: exact from the milliseconds, then the lead-in offset
+    const auto format = inputs.format.value;
+    const double position = milliseconds_to_time_format(position_ms, format);
+    outputs.position = position - this->convert_output(inputs.leadin.value);
+    outputs.timecode = position;
     outputs.valid = true;
   }
   else
@@ -229,55 +253,78 @@ void XWaxDVS::operator()(halp::tick_flicks tk)
     outputs.valid = false;
   }
 
-  // Calculate signal quality based on position and pitch stability
-  // Similar to Mixxx's approach
-  int position_quality = 0;
-  if(position_ms == -1)
-  {
-    position_quality = 0;
-  }
-  else if(m_quality_last_position == -1 ||
-          std::abs(position_ms - m_quality_last_position) >= 5)
+  // Kept by the timecoder at each reading of the bitstream
+  outputs.quality = timecoder_get_quality(m_timecoder);
+  outputs.lifted = timecoder_is_lifted(m_timecoder);
+
+  // The position was read `when` seconds before the end of the block
+  publish_snapshot(
+      position_ms >= 0, position_ms / 1000. - inputs.leadin.value + when * pitch, pitch);
+  timer.stop();
+  publish_stats(m_stats, outputs);
+}
+
+void XWaxDVS::output_invalid(ProcessStats::tick_timer& timer) noexcept
+{
+  outputs.speed = 0.0;
+  outputs.tempo = 0.0;
+  outputs.position = 0.0;
+  outputs.timecode = -1;
+  outputs.quality = 0.0;
+  outputs.valid = false;
+  outputs.lifted = true;
+  publish_snapshot(false, 0., 0.);
+  timer.stop();
+  publish_stats(m_stats, outputs);
+}
+
+void XWaxDVS::publish_snapshot(bool valid, double seconds, double speed) noexcept
+{
+  TimecodeSnapshot s{};
+  s.seconds = valid ? seconds : 0.;
+  s.speed = speed;
+  s.sample = m_sample_position;
+  s.steady_ns = TimecodeSnapshot::now_ns();
+  s.valid = valid;
+  m_publisher->publish(s);
+}
+
+bool XWaxDVS::update_gate(int frames) noexcept
+{
+  if(inputs.gate.value <= gate_off)
   {
-    // Position changed by at least 5ms - normal operation
-    position_quality = 100;
+    m_gate_open = true;
+    m_gate_quiet = 0;
+    return true;
   }
-  else
+
+  const double energy = block_energy(
+      inputs.audio.channel(0, frames).data(), inputs.audio.channel(1, frames).data(),
+      frames);
+
+  // Compared as energies: the levels are in dB of amplitude
+  const double gate = inputs.gate.value;
+  const double open = std::pow(10., gate / 10.);
+  const double close = std::pow(10., (gate - inputs.hysteresis.value) / 10.);
+
+  if(energy > open)
   {
-    // Position changed by less than 5ms - might indicate issues
-    position_quality = 50;
+    m_gate_open = true;
+    m_gate_quiet = 0;
   }
-  m_quality_last_position = position_ms;
-
-  int pitch_quality = 0;
-  if(m_quality_ring_filled > 0)
+  else if(energy < close)
   {
-    const double pitch_diff = pitch - m_quality_last_pitch;
-    if(pitch_diff != 0.0)
+    if(m_gate_open)
     {
-      const double pitch_stability = std::abs(pitch / pitch_diff);
-      if(pitch_stability < 3.0)
-        pitch_quality = 0;
-      else if(pitch_stability > 6.0)
-        pitch_quality = 100;
-      else
-        pitch_quality = 75;
+      m_gate_quiet += frames;
+      m_gate_open = m_gate_quiet < gate_hold * m_setup.rate;
     }
   }
-  m_quality_last_pitch = pitch;
-
-  // Update quality ring buffer
-  m_quality_ring[m_quality_ring_index] = position_quality + pitch_quality;
-  m_quality_ring_index = (m_quality_ring_index + 1) % QUALITY_RING_SIZE;
-  if(m_quality_ring_filled < QUALITY_RING_SIZE)
-    m_quality_ring_filled++;
-
-  // Calculate average quality
-  const int quality_sum = std::accumulate(
-      m_quality_ring, m_quality_ring + m_quality_ring_filled, 0);
-  const double quality = static_cast<double>(quality_sum) /
-                         (2.0 * 100.0 * static_cast<double>(m_quality_ring_filled));
-  outputs.quality = std::clamp(quality, 0.0, 1.0);
+  else
+  {
+    m_gate_quiet = 0;
+  }
+  return m_gate_open;
 }
 
 }
@@ -2,16 +2,24 @@
 
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
+#include "ProcessStats.hpp"
+#include "TimecodeMath.hpp"
+#include "TimecodeSnapshot.hpp"
+#include "XWaxDefinitions.hpp"
+#include "XWaxScope.hpp"
+
 #include <halp/audio.hpp>
 #include <halp/controls.hpp>
 #include <halp/meta.hpp>
 
-#include <vector>
+#include <array>
+#include <memory>
 
 // Forward declare the xwax timecoder struct
 extern "C" {
 struct timecoder;
 struct timecode_def;
+struct timecoder_scope;
 }
 
 namespace ao
@@ -59,17 +67,15 @@ struct XWaxDVS
   enum PitchFilter
   {
     Kalman,
-    AlphaBeta
+    AlphaBeta,
+    // The Kalman filter, with the steady-state gains of the sample rate
+    KalmanFast
   };
 
-  enum class OutputFormat
-  {
-    Seconds,
-    Milliseconds,
-    Microseconds,
-    Nanoseconds,
-    Flicks
-  };
+  using OutputFormat = TimeFormat;
+
+  // The Gate input at this level disables it
+  static constexpr float gate_off = -96.f;
 
   struct
   {
@@ -80,6 +86,24 @@ struct XWaxDVS
     halp::knob_f32<"Lead-in", halp::range{0.f, 60.f, 0.f}> leadin;
     halp::spinbox_f32<"Tempo", halp::range{0.f, 300.f, 120.f}> tempo;
     halp::combobox_t<"Output Format", OutputFormat> format{OutputFormat::Seconds};
+
+    // Builds the lookup tables of every format in the background, so that
+    // switching vinyl type later on is instantaneous. They stay loaded for as long
+    // as any process has this on.
+    struct : halp::toggle<"Pre-warm all formats">
+    {
+      void update(XWaxDVS& self) { self.prewarm(value); }
+    } prewarm;
+
+    // Sends decimated x-y points of the input to scope()
+    halp::toggle<"Scope"> scope;
+
+    // Off at gate_off, the default. Otherwise idle decks are not decoded: once
+    // the RMS level of the input has stayed under the gate minus the hysteresis
+    // for gate_hold, until it is back above the gate. The timecoder resumes where
+    // it was.
+    halp::knob_f32<"Gate (dBFS)", halp::range{-96.f, 0.f, -96.f}> gate;
+    halp::knob_f32<"Gate hysteresis (dB)", halp::range{0.f, 24.f, 6.f}> hysteresis;
   } inputs;
 
   struct
@@ -96,48 +120,68 @@ struct XWaxDVS
     // Speed * input tempo
     halp::val_port<"Tempo", double> tempo;
 
-    // Signal quality (0.0 = no signal, 1.0 = excellent)
+    // Signal quality (0.0 = no signal, 1.0 = excellent): the share of the last
+    // readings of the timecode which passed the error check
     halp::val_port<"Quality", double> quality;
 
     // Whether a valid position is currently available
     halp::val_port<"Valid", bool> valid;
+
+    // No timecode read lately: the needle is up, or the record is stopped. The
+    // position stays valid at a standstill, unless the gate is on and closes.
+    halp::val_port<"Lifted", bool> lifted;
+
+#if SCORE_ADDON_LTC_STATS
+    halp::val_port<"Stats: load", double> stats_load;
+    halp::val_port<"Stats: decoded positions", int> stats_decoded;
+    halp::val_port<"Stats: lost positions", int> stats_dropped;
+    halp::val_port<"Stats: timecoder inits", int> stats_reinits;
+    halp::val_port<"Stats: LUT load (ms)", double> stats_lut_build;
+#endif
   } outputs;
 
   XWaxDVS();
   ~XWaxDVS();
 
   void prepare(halp::setup setup);
+  void prewarm(bool enable);
 
   using tick = halp::tick_flicks;
   void operator()(halp::tick_flicks tk);
 
+  const ProcessStats& stats() const noexcept { return m_stats; }
+
+  // Points of the x-y scope, to be drawn by the UI thread, e.g. with a ScopeRaster
+  std::shared_ptr<ScopeRing> scope() const noexcept { return m_scope_ring; }
+
+  // Published after every tick, with the position at its end in seconds. Can be
+  // read from any thread, for as long as it is held.
+  std::shared_ptr<const TimecodePublisher> snapshots() const noexcept
+  {
+    return m_publisher;
+  }
+
 private:
-  // Initialize or reinitialize the timecoder with current settings
+  // Initialize or reinitialize the timecoder with the current definition and settings.
+  // This does not allocate: the definition is loaded asynchronously beforehand.
   void init_timecoder();
   void clear_timecoder();
+  void update_scope() noexcept;
+
+  // Whether the block is decoded, from its level and the state of the gate
+  bool update_gate(int frames) noexcept;
+
+  void publish_snapshot(bool valid, double seconds, double speed) noexcept;
+
+  // Outputs and publishes the state of a deck without timecode, at the end of
+  // the tick
+  void output_invalid(ProcessStats::tick_timer& timer) noexcept;
 
-  double convert_output(double seconds) const
+  double convert_output(double seconds) const noexcept
   {
-    switch(inputs.format.value)
-    {
-      case OutputFormat::Seconds:
-        return seconds;
-      case OutputFormat::Milliseconds:
-        return seconds * 1000.0;
-      case OutputFormat::Microseconds:
-        return seconds * 1e6;
-      case OutputFormat::Nanoseconds:
-        return seconds * 1e9;
-      case OutputFormat::Flicks:
-        return seconds * 705'600'000.0;
-      default:
-        return seconds;
-    }
+    return to_time_format(seconds, inputs.format.value);
   }
 
-  // Get the xwax timecode name for the current vinyl type
-  const char* get_timecode_name() const;
-
   // Get the speed multiplier for the current RPM setting
   double get_speed_multiplier() const;
 
@@ -147,24 +191,37 @@ private:
   struct timecoder* m_timecoder{nullptr};
   struct timecode_def* m_timecode_def{nullptr};
 
-  // Work buffer for converting double samples to 16-bit signed shorts
-  std::vector<signed short> m_work_buffer;
+  // Shared with the worker thread which builds the lookup tables
+  std::shared_ptr<XWaxDefinitionRequest> m_request;
+  int m_worker_task{-1};
+  XWaxPrewarmRequest m_prewarm;
 
   // Track the last settings to detect changes
   int m_last_vinyl_type{-1};
   int m_last_speed{-1};
   int m_last_pitch_filter{-1};
+  struct timecode_def* m_last_timecode_def{nullptr};
+
+  // Points given out by the timecoder in a tick, then pushed to the ring. The
+  // decimation keeps a whole block within them.
+  static constexpr int scope_points = 1024;
+  struct timecoder_scope* m_scope{nullptr};
+  std::array<float, scope_points> m_scope_x{}, m_scope_y{};
+  std::shared_ptr<ScopeRing> m_scope_ring;
 
-  // Quality tracking
-  static constexpr int QUALITY_RING_SIZE = 32;
-  int m_quality_ring[QUALITY_RING_SIZE]{};
-  int m_quality_ring_index{0};
-  int m_quality_ring_filled{0};
-  int m_quality_last_position{-1};
-  double m_quality_last_pitch{0.0};
+  std::shared_ptr<TimecodePublisher> m_publisher;
+  int64_t m_sample_position{0};
+
+  // The gate closes after this long under its lower level, so that the direction
+  // changes of a scratch, where the level dips, are still decoded
+  static constexpr double gate_hold = 0.1;
+  bool m_gate_open{true};
+  int m_gate_quiet{0}; // Frames under the lower level
 
   // Whether the timecoder has been initialized
   bool m_initialized{false};
+
+  ProcessStats m_stats;
 };
 
 }
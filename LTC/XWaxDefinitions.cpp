@@ -0,0 +1,253 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "XWaxDefinitions.hpp"
+
+#include "Worker.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+
+#include <timecoder.h>
+
+#include <chrono>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace ao
+{
+
+// Timecode format name mapping
+static constexpr const char* timecode_names[] = {
+    "serato_2a",      // Serato_2a
+    "serato_2b",      // Serato_2b
+    "serato_cd",      // Serato_CD
+    "traktor_a",      // Traktor_A
+    "traktor_b",      // Traktor_B
+    "traktor_mk2_a",  // Traktor_MK2_A
+    "traktor_mk2_b",  // Traktor_MK2_B
+    "traktor_mk2_cd", // Traktor_MK2_CD
+    "mixvibes_v2",    // MixVibes_V2
+    "mixvibes_7inch", // MixVibes_7inch
+    "pioneer_a",      // Pioneer_A
+    "pioneer_b",      // Pioneer_B
+};
+static_assert(std::size(timecode_names) == XWaxDefinitions::count);
+
+// The state below is never destroyed: the Worker is constructed first, so its
+// thread can still acquire and release definitions during the static destruction
+// at exit.
+
+// xwax keeps its definitions in a process-global table
+static std::mutex& definitions_mutex()
+{
+  static auto* m = new std::mutex;
+  return *m;
+}
+
+// Number of live handles per loaded definition, guarded by definitions_mutex()
+static std::map<timecode_def*, int>& definitions_refcount()
+{
+  static auto* refs = new std::map<timecode_def*, int>;
+  return *refs;
+}
+
+// Number of users of the prewarmed tables: the worker holds a handle to every
+// definition while there is any. Atomic, as the audio thread can change it.
+static std::atomic_int prewarm_users{0};
+static std::atomic_bool prewarm_changed{false};
+
+// Guarded by definitions_mutex()
+static std::string& cache_path()
+{
+  static auto* path = new std::string{[] {
+    QString dir = QString::fromUtf8(qgetenv("SCORE_XWAX_LUT_DIR").constData());
+    if(dir.isEmpty())
+    {
+      dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+      if(dir.isEmpty())
+        return std::string{};
+      dir = dir + "/xwax";
+    }
+
+    if(!QDir{}.mkpath(dir))
+      return std::string{};
+    return QFile::encodeName(dir).toStdString();
+  }()};
+  return *path;
+}
+
+const char* XWaxDefinitions::name(int format) noexcept
+{
+  if(format >= 0 && format < count)
+    return timecode_names[format];
+  return timecode_names[0]; // Default to Serato 2a
+}
+
+XWaxDefinitionHandle::XWaxDefinitionHandle(XWaxDefinitionHandle&& other) noexcept
+    : m_def{std::exchange(other.m_def, nullptr)}
+{
+}
+
+XWaxDefinitionHandle& XWaxDefinitionHandle::operator=(XWaxDefinitionHandle&& other) noexcept
+{
+  if(this != &other)
+  {
+    reset();
+    m_def = std::exchange(other.m_def, nullptr);
+  }
+  return *this;
+}
+
+XWaxDefinitionHandle::~XWaxDefinitionHandle()
+{
+  reset();
+}
+
+void XWaxDefinitionHandle::reset() noexcept
+{
+  if(m_def)
+    XWaxDefinitions::release(std::exchange(m_def, nullptr));
+}
+
+void XWaxDefinitions::init()
+{
+  static std::once_flag flag;
+  std::call_once(flag, [] {
+    Worker::instance().add([] {
+      // Only ever touched from the worker thread. Never destroyed either: the
+      // tables still held at exit go with the process.
+      static auto& prewarmed = *new std::vector<XWaxDefinitionHandle>;
+
+      if(!prewarm_changed.exchange(false, std::memory_order_acq_rel))
+        return;
+
+      if(prewarm_users.load(std::memory_order_acquire) > 0)
+      {
+        if(prewarmed.empty())
+          for(int i = 0; i < count; i++)
+            prewarmed.push_back(acquire(i));
+      }
+      else
+      {
+        prewarmed.clear();
+      }
+    });
+  });
+}
+
+XWaxDefinitionHandle XWaxDefinitions::acquire(int format)
+{
+  std::lock_guard lock{definitions_mutex()};
+
+  // Find the timecode definition: this maps the LUT from the cache directory,
+  // or builds and stores it there if needed
+  const auto& dir = cache_path();
+  const char* lut_dir = dir.empty() ? nullptr : dir.c_str();
+  auto def = timecoder_find_definition(name(format), lut_dir);
+
+  // Fallback to serato_2a if the requested format fails
+  if(!def)
+    def = timecoder_find_definition(timecode_names[0], lut_dir);
+  if(!def)
+    return {};
+
+  definitions_refcount()[def]++;
+  return XWaxDefinitionHandle{def};
+}
+
+void XWaxDefinitions::release(timecode_def* def) noexcept
+{
+  std::lock_guard lock{definitions_mutex()};
+
+  auto& refs = definitions_refcount();
+  auto it = refs.find(def);
+  if(it == refs.end())
+    return;
+
+  if(--it->second == 0)
+  {
+    refs.erase(it);
+    timecoder_free_definition(def);
+  }
+}
+
+std::string XWaxDefinitions::cache_directory()
+{
+  std::lock_guard lock{definitions_mutex()};
+  return cache_path();
+}
+
+void XWaxDefinitions::set_cache_directory(std::string path)
+{
+  if(!path.empty())
+    QDir{}.mkpath(QString::fromStdString(path));
+
+  std::lock_guard lock{definitions_mutex()};
+  cache_path() = std::move(path);
+}
+
+void XWaxPrewarmRequest::set(bool enable) noexcept
+{
+  if(std::exchange(m_enabled, enable) == enable)
+    return;
+
+  if(enable)
+    XWaxDefinitions::add_prewarm_user();
+  else
+    XWaxDefinitions::remove_prewarm_user();
+}
+
+void XWaxDefinitions::add_prewarm_user() noexcept
+{
+  prewarm_users.fetch_add(1, std::memory_order_acq_rel);
+  prewarm_changed.store(true, std::memory_order_release);
+  Worker::instance().wake();
+}
+
+void XWaxDefinitions::remove_prewarm_user() noexcept
+{
+  prewarm_users.fetch_sub(1, std::memory_order_acq_rel);
+  prewarm_changed.store(true, std::memory_order_release);
+  Worker::instance().wake();
+}
+
+void XWaxDefinitionRequest::process()
+{
+  // The audio thread adopted the published definition: the previous one can go
+  if(m_pending && in_use.load(std::memory_order_acquire) == m_pending.get())
+  {
+    m_current = std::move(m_pending);
+    m_current_format = m_pending_format;
+    m_pending_format = -1;
+  }
+
+  // Wait for the acknowledgement before publishing anything else
+  if(m_pending)
+    return;
+
+  const int format = requested.load(std::memory_order_acquire);
+  if(format < 0 || format == m_current_format)
+    return;
+
+  const auto start = std::chrono::steady_clock::now();
+  m_pending = XWaxDefinitions::acquire(format);
+  load_ns.store(
+      uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - start)
+                   .count()),
+      std::memory_order_relaxed);
+  if(!m_pending)
+  {
+    // Nothing usable: do not retry until another format is requested
+    m_current_format = format;
+    return;
+  }
+
+  m_pending_format = format;
+  published.store(m_pending.get(), std::memory_order_release);
+}
+}
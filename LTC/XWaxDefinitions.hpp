@@ -0,0 +1,133 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+extern "C" {
+struct timecode_def;
+}
+
+namespace ao
+{
+/**
+ * @brief Reference to a loaded xwax timecode definition
+ *
+ * The lookup table of a definition is shared by every XWaxDVS instance using that
+ * format and released when the last handle goes away. Releasing can free or unmap
+ * megabytes: handles must not be destroyed on the audio thread.
+ */
+class XWaxDefinitionHandle
+{
+public:
+  XWaxDefinitionHandle() noexcept = default;
+  XWaxDefinitionHandle(const XWaxDefinitionHandle&) = delete;
+  XWaxDefinitionHandle& operator=(const XWaxDefinitionHandle&) = delete;
+  XWaxDefinitionHandle(XWaxDefinitionHandle&& other) noexcept;
+  XWaxDefinitionHandle& operator=(XWaxDefinitionHandle&& other) noexcept;
+  ~XWaxDefinitionHandle();
+
+  timecode_def* get() const noexcept { return m_def; }
+  explicit operator bool() const noexcept { return m_def != nullptr; }
+
+  void reset() noexcept;
+
+private:
+  friend struct XWaxDefinitions;
+  explicit XWaxDefinitionHandle(timecode_def* def) noexcept
+      : m_def{def}
+  {
+  }
+
+  timecode_def* m_def{};
+};
+
+/**
+ * @brief Request of a processor to keep the lookup tables of every format loaded
+ *
+ * The worker thread loads them in the background while any request is enabled,
+ * so that switching vinyl type is instantaneous, and releases them once the last
+ * one is disabled or destroyed. Real-time safe.
+ */
+class XWaxPrewarmRequest
+{
+public:
+  XWaxPrewarmRequest() noexcept = default;
+  XWaxPrewarmRequest(const XWaxPrewarmRequest&) = delete;
+  XWaxPrewarmRequest& operator=(const XWaxPrewarmRequest&) = delete;
+  ~XWaxPrewarmRequest() { set(false); }
+
+  bool enabled() const noexcept { return m_enabled; }
+  void set(bool enable) noexcept;
+
+private:
+  bool m_enabled{false};
+};
+
+/**
+ * @brief Access to the xwax timecode definitions from C++
+ *
+ * Building the lookup table of a definition walks the whole LFSR sequence of the
+ * format and allocates several megabytes: this must never happen on the audio thread.
+ * Processors thus post a request which is fulfilled on the shared Worker thread.
+ *
+ * Built tables are stored in the cache directory and memory-mapped on the next
+ * load, so that a session only pays for the construction once per machine.
+ */
+struct XWaxDefinitions
+{
+  // Number of formats, indexed like XWaxDVS::VinylType
+  static constexpr int count = 12;
+
+  static const char* name(int format) noexcept;
+
+  // Registers the background task; call once from a non real-time context
+  static void init();
+
+  // Thread-safe. Builds the lookup table if no other handle holds it, which can take
+  // a long time: never call this from the audio thread.
+  // Falls back to Serato 2a if the format cannot be loaded.
+  static XWaxDefinitionHandle acquire(int format);
+
+
+  // Directory where the lookup tables are cached across sessions.
+  // Defaults to $SCORE_XWAX_LUT_DIR if set, otherwise to the score user data folder.
+  // An empty path disables the cache.
+  static std::string cache_directory();
+  static void set_cache_directory(std::string path);
+
+private:
+  friend class XWaxDefinitionHandle;
+  friend class XWaxPrewarmRequest;
+  static void release(timecode_def* def) noexcept;
+  static void add_prewarm_user() noexcept;
+  static void remove_prewarm_user() noexcept;
+};
+
+/**
+ * @brief Hand-over of definitions between the worker and the audio thread
+ *
+ * The audio thread writes `requested` then wakes the worker. The worker acquires
+ * the definition and publishes it in `published`; the audio thread adopts it and
+ * acknowledges through `in_use`. Only then does the worker drop the previous
+ * handle, so that a table is never released while a timecoder still reads it.
+ */
+struct XWaxDefinitionRequest
+{
+  std::atomic_int requested{-1};
+  std::atomic<timecode_def*> published{nullptr};
+  std::atomic<timecode_def*> in_use{nullptr};
+
+  // Time taken to load or build the last published definition, for ProcessStats
+  std::atomic<uint64_t> load_ns{0};
+
+  // Worker thread
+  void process();
+
+private:
+  XWaxDefinitionHandle m_current, m_pending;
+  int m_current_format{-1}, m_pending_format{-1};
+};
+}
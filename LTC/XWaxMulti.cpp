@@ -0,0 +1,107 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "XWaxMulti.hpp"
+
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+
+namespace ao
+{
+
+void XWaxMultiDVS::configure(XWaxDVS& deck) const noexcept
+{
+  deck.inputs.vinyl_type.value = inputs.vinyl_type.value;
+  deck.inputs.speed.value = inputs.speed.value;
+  deck.inputs.pitch_filter.value = inputs.pitch_filter.value;
+  deck.inputs.leadin.value = inputs.leadin.value;
+  deck.inputs.tempo.value = inputs.tempo.value;
+  deck.inputs.format.value = inputs.format.value;
+  deck.inputs.gate.value = inputs.gate.value;
+  deck.inputs.hysteresis.value = inputs.hysteresis.value;
+}
+
+void XWaxMultiDVS::prepare(halp::setup setup)
+{
+  halp::setup deck_setup = setup;
+  deck_setup.input_channels = 2;
+  deck_setup.output_channels = 0;
+
+  // The decks there already are keep their lookup table
+  const int decks = std::max(setup.input_channels, 0) / 2;
+  m_decks.resize(decks);
+  for(auto& deck : m_decks)
+  {
+    if(!deck)
+      deck = std::make_unique<XWaxDVS>();
+    configure(*deck);
+    deck->prepare(deck_setup);
+  }
+
+  outputs.positions.value.reserve(decks);
+  outputs.speeds.value.reserve(decks);
+  outputs.tempos.value.reserve(decks);
+  outputs.quality.value.reserve(decks);
+  outputs.valid.value.reserve(decks);
+
+  if(inputs.prewarm)
+    prewarm(true);
+}
+
+void XWaxMultiDVS::prewarm(bool enable)
+{
+  m_prewarm.set(enable);
+}
+
+void XWaxMultiDVS::decode(void* self, int deck) noexcept
+{
+  auto& multi = *static_cast<XWaxMultiDVS*>(self);
+  (*multi.m_decks[deck])(multi.m_tick);
+}
+
+void XWaxMultiDVS::operator()(halp::tick_flicks tk)
+{
+  const int count
+      = std::min(inputs.audio.channels / 2, static_cast<int>(m_decks.size()));
+
+  // Within the capacity reserved in prepare()
+  outputs.positions.value.assign(count, 0.);
+  outputs.speeds.value.assign(count, 0.);
+  outputs.tempos.value.assign(count, 0.);
+  outputs.quality.value.assign(count, 0.);
+  outputs.valid.value.clear();
+
+  if(count <= 0)
+    return;
+
+  m_tick = tk;
+  for(int i = 0; i < count; i++)
+  {
+    auto& deck = *m_decks[i];
+    configure(deck);
+    deck.inputs.audio.samples = inputs.audio.samples + 2 * i;
+    deck.inputs.audio.channels = 2;
+  }
+
+  if(inputs.parallel)
+  {
+    WorkerPool::instance().run(&XWaxMultiDVS::decode, this, count);
+  }
+  else
+  {
+    for(int i = 0; i < count; i++)
+      decode(this, i);
+  }
+
+  for(int i = 0; i < count; i++)
+  {
+    const auto& deck = m_decks[i]->outputs;
+    outputs.positions.value[i] = deck.position.value;
+    outputs.speeds.value[i] = deck.speed.value;
+    outputs.tempos.value[i] = deck.tempo.value;
+    outputs.quality.value[i] = deck.quality.value;
+    if(deck.valid.value)
+      outputs.valid.value.push_back(i);
+  }
+}
+}
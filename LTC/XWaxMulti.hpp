@@ -0,0 +1,90 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "XWax.hpp"
+#include "XWaxDefinitions.hpp"
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace ao
+{
+/**
+ * @brief DVS decoding of several decks in one process
+ *
+ * Each pair of input channels is a deck, with the left channel first, decoded
+ * by its own XWaxDVS. The decks share the settings of the process.
+ *
+ * The decks are independent: with "Parallel", they are decoded on the
+ * WorkerPool, together with the audio thread, instead of one after the other.
+ */
+struct XWaxMultiDVS
+{
+  halp_meta(name, "XWax Multi DVS")
+  halp_meta(author, "ossia team")
+  halp_meta(category, "Audio/Timing")
+  halp_meta(manual_url, "https://ossia.io/score-docs/processes/xwax-dvs.html")
+  halp_meta(c_name, "avnd_xwax_multi_dvs")
+  halp_meta(uuid, "4fc6814e-7ff1-468e-90a4-bb17fe854aa8")
+  halp_meta(description, "Decode the DVS timecode of every stereo pair of a bus")
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Timecode", double> audio;
+    halp::combobox_t<"Vinyl Type", XWaxDVS::VinylType> vinyl_type;
+    halp::enum_t<XWaxDVS::Speed, "Speed"> speed;
+    halp::enum_t<XWaxDVS::PitchFilter, "Pitch Filter"> pitch_filter;
+    halp::knob_f32<"Lead-in", halp::range{0.f, 60.f, 0.f}> leadin;
+    halp::spinbox_f32<"Tempo", halp::range{0.f, 300.f, 120.f}> tempo;
+    halp::combobox_t<"Output Format", XWaxDVS::OutputFormat> format{
+        XWaxDVS::OutputFormat::Seconds};
+
+    // As that of XWaxDVS
+    struct : halp::toggle<"Pre-warm all formats">
+    {
+      void update(XWaxMultiDVS& self) { self.prewarm(value); }
+    } prewarm;
+
+    // As that of XWaxDVS: off at XWaxDVS::gate_off
+    halp::knob_f32<"Gate (dBFS)", halp::range{-96.f, 0.f, -96.f}> gate;
+    halp::knob_f32<"Gate hysteresis (dB)", halp::range{0.f, 24.f, 6.f}> hysteresis;
+
+    halp::toggle<"Parallel", halp::toggle_setup{true}> parallel;
+  } inputs;
+
+  struct
+  {
+    // One per deck: as the outputs of XWaxDVS, 0 where invalid
+    halp::val_port<"Timecodes", std::vector<double>> positions;
+    halp::val_port<"Speeds", std::vector<double>> speeds;
+    halp::val_port<"Tempos", std::vector<double>> tempos;
+    halp::val_port<"Quality", std::vector<double>> quality;
+
+    // Decks with a valid position
+    halp::val_port<"Valid decks", std::vector<int>> valid;
+  } outputs;
+
+  void prepare(halp::setup setup);
+  void prewarm(bool enable);
+
+  using tick = halp::tick_flicks;
+  void operator()(halp::tick_flicks tk);
+
+private:
+  static void decode(void* self, int deck) noexcept;
+
+  // Copies the settings of the process to a deck
+  void configure(XWaxDVS& deck) const noexcept;
+
+  // Allocated one by one, so that decks decoded on different threads do not
+  // share cache lines
+  std::vector<std::unique_ptr<XWaxDVS>> m_decks;
+  halp::tick_flicks m_tick{};
+  XWaxPrewarmRequest m_prewarm;
+};
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ao
+{
+struct ScopePoint
+{
+  float x, y;
+};
+
+/**
+ * @brief Single-producer single-consumer ring of scope points
+ *
+ * The audio thread pushes the decimated x-y points given out by the xwax
+ * timecoder, the UI thread pops them. Neither blocks nor allocates: when the UI
+ * does not keep up, the newest points are dropped.
+ */
+class ScopeRing
+{
+public:
+  static constexpr std::size_t capacity = 8192;
+
+  // Audio thread
+  void push(const float* x, const float* y, std::size_t n) noexcept
+  {
+    const auto w = m_write.load(std::memory_order_relaxed);
+    const auto r = m_read.load(std::memory_order_acquire);
+    n = std::min(n, capacity - (w - r));
+    for(std::size_t i = 0; i < n; i++)
+      m_points[(w + i) % capacity] = {x[i], y[i]};
+    m_write.store(w + n, std::memory_order_release);
+  }
+
+  // UI thread
+  std::size_t pop(ScopePoint* out, std::size_t max) noexcept
+  {
+    const auto r = m_read.load(std::memory_order_relaxed);
+    const auto w = m_write.load(std::memory_order_acquire);
+    const auto n = std::min(max, w - r);
+    for(std::size_t i = 0; i < n; i++)
+      out[i] = m_points[(r + i) % capacity];
+    m_read.store(r + n, std::memory_order_release);
+    return n;
+  }
+
+private:
+  std::array<ScopePoint, capacity> m_points{};
+  alignas(64) std::atomic<std::size_t> m_write{0};
+  alignas(64) std::atomic<std::size_t> m_read{0};
+};
+
+/**
+ * @brief x-y raster of the scope, as the xwax monitor drew it
+ *
+ * Runs on the UI thread: each update() fades the image, then plots the points
+ * received since the previous one.
+ */
+class ScopeRaster
+{
+public:
+  explicit ScopeRaster(int size)
+      : m_size{size}
+      , m_pixels(std::size_t(size) * size)
+  {
+  }
+
+  int size() const noexcept { return m_size; }
+  const uint8_t* pixels() const noexcept { return m_pixels.data(); }
+
+  // decay is the brightness kept from the previous update
+  void update(ScopeRing& ring, float decay = 7.f / 8.f)
+  {
+    for(auto& p : m_pixels)
+      p = static_cast<uint8_t>(p * decay);
+
+    ScopePoint points[256];
+    while(const auto n = ring.pop(points, std::size(points)))
+    {
+      for(std::size_t i = 0; i < n; i++)
+      {
+        const int px = static_cast<int>(m_size / 2.f * (1.f + points[i].x));
+        const int py = static_cast<int>(m_size / 2.f * (1.f + points[i].y));
+        if(px >= 0 && px < m_size && py >= 0 && py < m_size)
+          m_pixels[std::size_t(py) * m_size + px] = 0xff;
+      }
+    }
+  }
+
+private:
+  int m_size{};
+  std::vector<uint8_t> m_pixels;
+};
+}
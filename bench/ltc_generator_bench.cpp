@@ -0,0 +1,131 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+/**
+ * LTC generation throughput, in samples per second.
+ *
+ * "before" is the former LTCGenerator loop, which popped the samples one by one
+ * from a boost::circular_buffer refilled a byte at a time; "libltc" is
+ * LTCBlockEncoder off the nominal speed, encoding through libltc, and "nominal" the
+ * same at the nominal speed, copying the prerendered runs.
+ */
+
+#include <LTC/LTCEncoder.hpp>
+
+#include <boost/circular_buffer.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+constexpr int block = 512;
+constexpr double seconds = 60.;
+constexpr double speed = 1.;
+// Close enough to the nominal speed to compare, far enough to go through libltc
+constexpr double off_speed = 1.0001;
+
+SMPTETimecode start_time()
+{
+  return SMPTETimecode{
+      .timezone = "+0000",
+      .years = 0,
+      .months = 0,
+      .days = 0,
+      .hours = 1,
+      .mins = 0,
+      .secs = 0,
+      .frame = 0};
+}
+
+struct before
+{
+  LTCEncoder* encoder{};
+  int current_byte{};
+  boost::circular_buffer<uint8_t> buffer;
+
+  explicit before(double rate)
+  {
+    encoder = ltc_encoder_create(rate, 30., LTC_TV_525_60, 0);
+    auto st = start_time();
+    ltc_encoder_set_timecode(encoder, &st);
+    buffer = boost::circular_buffer<uint8_t>(ltc_encoder_get_buffersize(encoder) * 16);
+  }
+  ~before() { ltc_encoder_free(encoder); }
+
+  void operator()(double* out, int frames)
+  {
+    for(int frame = 0; frame < frames; ++frame)
+    {
+      while(buffer.empty())
+      {
+        ltc_encoder_encode_byte(encoder, current_byte, speed);
+        if(++current_byte == 10)
+        {
+          ltc_encoder_inc_timecode(encoder);
+          current_byte = 0;
+        }
+
+        ltcsnd_sample_t* buf{};
+        int len = ltc_encoder_get_bufferptr(encoder, &buf, true);
+        for(int i = 0; i < len; i++)
+          buffer.push_back(buf[i]);
+      }
+
+      ltcsnd_sample_t data = buffer.front();
+      buffer.pop_front();
+      out[frame] = (data / 127.f) - 1.f;
+    }
+  }
+};
+
+template <double Speed>
+struct after
+{
+  ao::LTCBlockEncoder encoder;
+
+  explicit after(double rate)
+  {
+    encoder.prepare(rate);
+    encoder.reset(LTC_TV_525_60, start_time());
+  }
+
+  void operator()(double* out, int frames) { encoder.process(out, frames, Speed); }
+};
+
+template <typename Generator>
+double samples_per_second(double rate)
+{
+  Generator gen{rate};
+  std::vector<double> out(block);
+  const long total = static_cast<long>(rate * seconds);
+
+  double checksum = 0.;
+  const auto t0 = std::chrono::steady_clock::now();
+  for(long done = 0; done < total; done += block)
+  {
+    gen(out.data(), block);
+    checksum += out[block - 1];
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+
+  std::fprintf(stderr, "(checksum %g)\n", checksum);
+  return total / std::chrono::duration<double>(t1 - t0).count();
+}
+}
+
+int main()
+{
+  std::printf(
+      "%8s %16s %16s %17s %8s\n", "rate", "before (Msmp/s)", "libltc (Msmp/s)",
+      "nominal (Msmp/s)", "ratio");
+  for(double rate : {48000., 96000., 192000.})
+  {
+    const double b = samples_per_second<before>(rate);
+    const double l = samples_per_second<after<off_speed>>(rate);
+    const double n = samples_per_second<after<speed>>(rate);
+    std::printf(
+        "%8.0f %16.1f %16.1f %17.1f %7.1fx\n", rate, b / 1e6, l / 1e6, n / 1e6, n / b);
+  }
+  return 0;
+}
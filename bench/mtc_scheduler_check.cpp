@@ -0,0 +1,180 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+/**
+ * Checks of the MIDI Time Code scheduling of MTC Output.
+ *
+ * MTCScheduler is fed the snapshots of a time code running at a known speed,
+ * block after block, as MTCOutput does. The messages must fall on the same
+ * samples whatever the block size, the quarter frames sample_rate / (4 fps)
+ * apart, and their sequences carry the frame they start on. Standstill and
+ * reverse only send full frames. The drop-frame labels are checked over three
+ * hours of frames.
+ *
+ * Exits with 1 after listing the checks which fail.
+ */
+
+#include <LTC/MTCOutput.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+namespace
+{
+using namespace ao;
+
+constexpr double sample_rate = 48000.;
+
+// Bytes of the messages, at the sample they are sent on from the start
+using schedule = std::map<int64_t, std::vector<uint8_t>>;
+
+int failures = 0;
+
+void check(bool ok, const char* what, const char* rate_name)
+{
+  if(!ok)
+  {
+    std::fprintf(stderr, "FAILED: %s at %s\n", what, rate_name);
+    failures++;
+  }
+}
+
+// The time code starts at `start` seconds, at the end of the first block
+schedule
+run(TimecodeRate rate, double start, double speed, int block, int64_t samples)
+{
+  MTCScheduler scheduler;
+  std::vector<halp::midi_msg> out;
+  schedule messages;
+  for(int64_t pos = 0; pos + block <= samples; pos += block)
+  {
+    TimecodeSnapshot snapshot{};
+    snapshot.seconds = start + speed * (pos + block) / sample_rate;
+    snapshot.speed = speed;
+    snapshot.sample = pos + block;
+    snapshot.valid = true;
+
+    out.clear();
+    scheduler.process(snapshot, rate, block, sample_rate, out);
+    for(const auto& m : out)
+    {
+      auto& bytes = messages[pos + m.timestamp];
+      bytes.insert(bytes.end(), m.bytes.begin(), m.bytes.end());
+    }
+  }
+  return messages;
+}
+
+// Same messages on the same samples, past the first block of the largest size
+bool same_schedule(const schedule& a, const schedule& b, int64_t from)
+{
+  return std::equal(a.lower_bound(from), a.end(), b.lower_bound(from), b.end());
+}
+
+void check_playback(TimecodeRate rate, const char* rate_name)
+{
+  // Across the end of a minute, where drop frames skip labels
+  // A multiple of each of the block sizes, so that they all end on it
+  constexpr double start = 59.5;
+  constexpr int64_t samples = 512'000;
+  const auto small = run(rate, start, 1., 64, samples);
+  const auto odd = run(rate, start, 1., 1000, samples);
+  const auto large = run(rate, start, 1., 4096, samples);
+  check(
+      same_schedule(small, large, 4096) && same_schedule(odd, large, 4096),
+      "messages on the same samples for blocks of 64, 1000 and 4096", rate_name);
+
+  const double spacing = sample_rate / (4. * rate.fps());
+  int64_t previous = -1;
+  bool spaced = true;
+  int sequences = 0;
+  bool decoded = true;
+  int pieces[8]{};
+  int next_piece = 0;
+  for(const auto& [at, bytes] : small)
+  {
+    if(bytes[0] != 0xF1)
+      continue;
+
+    if(previous >= 0)
+    {
+      const auto gap = at - previous;
+      spaced = spaced && (gap == int64_t(std::floor(spacing))
+                          || gap == int64_t(std::ceil(spacing)));
+    }
+    previous = at;
+
+    // Each sequence of 8 carries the labels of the frame of its first piece
+    const int piece = bytes[1] >> 4;
+    pieces[piece] = bytes[1] & 0xF;
+    next_piece = piece == next_piece ? next_piece + 1 : 0;
+    if(next_piece < 8)
+      continue;
+    next_piece = 0;
+    sequences++;
+
+    const int frame = pieces[0] | (pieces[1] << 4);
+    const int secs = pieces[2] | (pieces[3] << 4);
+    const int mins = pieces[4] | (pieces[5] << 4);
+    const int hours = pieces[6] | ((pieces[7] & 1) << 4);
+    const double first = start + (at - 7 * spacing) / sample_rate;
+    const auto frames = timecode_frames(hours, mins, secs, frame, rate);
+    decoded = decoded && std::abs(double(frames) - first * rate.fps()) <= 1.01;
+  }
+  check(spaced, "quarter frames sample_rate / (4 fps) apart", rate_name);
+  const double expected_sequences = samples / sample_rate * rate.fps() / 2.;
+  check(sequences >= int(expected_sequences) - 1, "complete sequences", rate_name);
+  check(decoded, "sequences carrying the frame they start on", rate_name);
+}
+
+void check_standstill_and_reverse()
+{
+  const auto full_frames = [](const schedule& s) {
+    int count = 0;
+    for(const auto& [at, bytes] : s)
+      count += bytes[0] == 0xF0 ? 1 : 0;
+    return count == int(s.size()) ? count : -1;
+  };
+
+  // A second at each speed, at 25 fps
+  const auto still = run(timecode_rate_25, 10., 0., 256, 48000);
+  check(full_frames(still) == 1, "a single full frame at a standstill", "25 fps");
+  const auto reverse = run(timecode_rate_25, 10., -1., 256, 48000);
+  check(full_frames(reverse) == 25, "a full frame per frame in reverse", "25 fps");
+}
+
+// timecode_labels inverts timecode_frames, and never labels a dropped frame
+void check_drop_frame_labels()
+{
+  const auto rate = timecode_rate_2997_drop;
+  bool round_trip = true;
+  bool dropped = true;
+  for(int64_t f = 0; f < 3 * timecode_frames(1, 0, 0, 0, rate); f++)
+  {
+    const auto l = timecode_labels(f, rate);
+    round_trip
+        = round_trip && timecode_frames(l.hours, l.mins, l.secs, l.frame, rate) == f;
+    dropped = dropped && !(l.mins % 10 != 0 && l.secs == 0 && l.frame < 2);
+  }
+  check(round_trip, "labels back to frames over 3 hours", "29.97 fps drop");
+  check(dropped, "no label of a dropped frame over 3 hours", "29.97 fps drop");
+}
+}
+
+int main()
+{
+  check_playback(timecode_rate_24, "24 fps");
+  check_playback(timecode_rate_25, "25 fps");
+  check_playback(timecode_rate_2997_drop, "29.97 fps drop");
+  check_playback(timecode_rate_30, "30 fps");
+  check_standstill_and_reverse();
+  check_drop_frame_labels();
+
+  if(failures > 0)
+    return 1;
+  std::printf("MTC scheduler: all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,726 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+/**
+ * Throughput, latency and accuracy of LTCGenerator, LTCInput and XWaxDVS.
+ *
+ *   processors_bench [--ltc file.wav] [--dvs format file.wav] [--lut-dir dir]
+ *                    [--baseline file | --save-baseline file]
+ *
+ * The synthetic corpora are LTC from LTCBlockEncoder at several speeds with white
+ * noise at -40 dBFS, and DVS built from the LFSR sequence of the xwax definitions,
+ * Traktor MK2 included, at constant speed and scratching back and forth. Recorded
+ * files can be added: they have no reference, so only their throughput and valid
+ * ratio are reported.
+ * The DVS corpora are run with each of the pitch filters of XWaxDVS, and four
+ * decks of them with XWaxMultiDVS, serially and on the worker pool, then with
+ * two of the decks silent.
+ *
+ * Each corpus is run at every block size, at the sample rates it is generated at:
+ * "x rt" is the speed over real time, the latencies are those of a single tick and
+ * the errors, in ms, against the reference of the synthetic corpora. The speed
+ * error of DVS is that of the pitch output, relative to the reference speed.
+ *
+ * --baseline compares the accuracy of the synthetic DVS corpora with that of a
+ * previous run, such as bench/processors_bench.baseline, and exits with an error
+ * if any of them is worse: this catches regressions of the local xwax patches.
+ * The timings depend on the machine and are not compared. --save-baseline writes
+ * the accuracy of the run instead, after a deliberate change of the decoders.
+ */
+
+#include <LTC/LTC.hpp>
+#include <LTC/LTCEncoder.hpp>
+#include <LTC/LTCInput.hpp>
+#include <LTC/XWax.hpp>
+#include <LTC/XWaxDefinitions.hpp>
+#include <LTC/XWaxMulti.hpp>
+#include <tools/ltc_analyze/WavReader.hpp>
+
+#include <timecoder.h>
+
+#include <algorithm>
+#include <bit>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <numbers>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+constexpr double flicks_per_second = 705'600'000.;
+constexpr double corpus_seconds = 10.;
+constexpr int block_sizes[] = {64, 256, 1024, 4096};
+constexpr double sample_rates[] = {44100., 48000., 96000.};
+
+// Results before this are not accounted for in the errors: the decoders lock first
+constexpr double settle_seconds = 1.;
+
+struct corpus
+{
+  std::string name;
+  double rate{};
+  std::vector<std::vector<double>> channels;
+
+  // Expected output in seconds at each sample, NaN if unknown
+  std::vector<double> reference;
+
+  // Expected DVS speed at each sample, empty if unknown
+  std::vector<double> reference_speed;
+
+  // DVS format
+  int format{-1};
+
+  // Part of the baseline
+  bool checked{};
+};
+
+struct result
+{
+  double realtime{};
+  double p50_us{}, p99_us{}, max_us{};
+  double valid{};
+  double mean_error_ms{}, max_error_ms{};
+  double mean_speed_error{};
+};
+
+void add_noise(std::vector<double>& channel, double level)
+{
+  std::mt19937 gen{1234};
+  std::normal_distribution<double> noise{0., level};
+  for(auto& s : channel)
+    s += noise(gen);
+}
+
+corpus ltc_corpus(double rate, double speed)
+{
+  const auto n = static_cast<std::size_t>(rate * corpus_seconds);
+  corpus c{
+      "LTC x" + std::to_string(speed).substr(0, 4), rate, {std::vector<double>(n)}, {}};
+
+  ao::LTCBlockEncoder encoder;
+  encoder.prepare(rate);
+  SMPTETimecode start{};
+  std::strcpy(start.timezone, "+0000");
+  start.hours = 1;
+  encoder.reset(LTC_TV_525_60, start);
+  encoder.process(c.channels[0].data(), static_cast<int>(n), speed);
+  add_noise(c.channels[0], 0.01);
+
+  c.reference.resize(n);
+  for(std::size_t i = 0; i < n; i++)
+    c.reference[i] = 3600. + i * speed / rate;
+  return c;
+}
+
+// The bit of each cycle of the carrier, as xwax builds its lookup tables
+std::vector<bool> lfsr_bits(const timecode_def* def)
+{
+  std::vector<bool> bits(def->length);
+  if(def->flags & TRAKTOR_MK2)
+  {
+    using mk2_code = std::bitset<128>;
+    const auto make
+        = [](mk2bits_t v) { return (mk2_code{v.high} << 64) | mk2_code{v.low}; };
+    mk2_code code = make(def->seed_mk2);
+    const mk2_code taps = make(def->taps_mk2) | mk2_code{1};
+    for(unsigned int i = 0; i < def->length; i++)
+    {
+      bits[i] = code[def->bits - 1];
+      const bool feedback = (code & taps).count() & 1;
+      code >>= 1;
+      code[def->bits - 1] = feedback;
+    }
+    return bits;
+  }
+
+  bits_t code = def->seed;
+  for(unsigned int i = 0; i < def->length; i++)
+  {
+    bits[i] = (code >> (def->bits - 1)) & 1;
+    const bits_t feedback = std::popcount(code & (def->taps | 1)) & 1;
+    code = (code >> 1) | (feedback << (def->bits - 1));
+  }
+  return bits;
+}
+
+// One cycle of the carrier per bit of the sequence, in quadrature on the two
+// channels: 1 bits have a larger amplitude. The MK2 decoder finds the extrema
+// of the carrier from its derivative and reads the bits from the jumps between
+// them: for it, the amplitude changes where each channel crosses zero, so that
+// the derivative stays continuous, and with a larger contrast. scratch goes back
+// and forth around the start position instead of playing at 33 rpm.
+corpus dvs_corpus(double rate, int format, bool scratch)
+{
+  auto handle = ao::XWaxDefinitions::acquire(format);
+  const timecode_def* def = handle.get();
+
+  const auto n = static_cast<std::size_t>(rate * corpus_seconds);
+  corpus c{
+      std::string{ao::XWaxDefinitions::name(format)} + (scratch ? " scratch" : ""),
+      rate,
+      {std::vector<double>(n), std::vector<double>(n)},
+      std::vector<double>(n),
+      std::vector<double>(n),
+      format,
+      true};
+
+  const auto bits = lfsr_bits(def);
+  const bool mk2 = (def->flags & TRAKTOR_MK2) != 0;
+  const auto amplitude = [&](double at) {
+    const auto cycle = static_cast<long>(std::floor(at)) % long(def->length);
+    return bits[cycle] ? 0.9 : (mk2 ? 0.4 : 0.6);
+  };
+
+  // Which channel leads depends on the primary and phase switches of the format
+  const bool phase = (def->flags & SWITCH_PHASE) != 0;
+  const bool primary = (def->flags & SWITCH_PRIMARY) != 0;
+  const double secondary_sign = phase != primary ? -1. : 1.;
+
+  double cycles = 10. * def->resolution;
+  for(std::size_t i = 0; i < n; i++)
+  {
+    const double t = i / rate;
+    const double speed = scratch ? 2. * std::sin(2. * std::numbers::pi * 0.5 * t) + 0.5
+                                 : 1.;
+    cycles += speed * def->resolution / rate;
+
+    const double angle = 2. * std::numbers::pi * cycles;
+    c.channels[0][i] = amplitude(mk2 ? cycles + 0.5 : cycles) * std::sin(angle);
+    c.channels[1][i]
+        = secondary_sign * amplitude(mk2 ? cycles + 0.25 : cycles) * std::cos(angle);
+    c.reference[i] = cycles / def->resolution;
+    c.reference_speed[i] = speed;
+  }
+  add_noise(c.channels[0], 0.01);
+  add_noise(c.channels[1], 0.01);
+  return c;
+}
+
+bool load_corpus(corpus& c, const char* path)
+{
+  ao::WavReader reader;
+  if(!reader.open(path))
+    return false;
+
+  c.rate = reader.rate();
+  const auto n = static_cast<int>(reader.frames());
+  c.channels.assign(reader.channels(), std::vector<double>(n));
+  std::vector<double*> planes;
+  for(auto& ch : c.channels)
+    planes.push_back(ch.data());
+  reader.read(0, planes.data(), n);
+  c.reference.assign(n, std::numeric_limits<double>::quiet_NaN());
+  return true;
+}
+
+struct statistics
+{
+  std::vector<double> tick_ns;
+  int64_t samples{};
+  int64_t blocks{}, valid{};
+  int64_t compared{};
+  double error_sum{}, error_max{};
+  int64_t speed_compared{};
+  double speed_error_sum{};
+
+  void tick(double ns, int frames)
+  {
+    tick_ns.push_back(ns);
+    samples += frames;
+    blocks++;
+  }
+
+  void compare(bool is_valid, double value, double reference, double t)
+  {
+    valid += is_valid;
+    if(!is_valid || std::isnan(reference) || t < settle_seconds)
+      return;
+    const double e = std::abs(value - reference) * 1000.;
+    error_sum += e;
+    error_max = std::max(error_max, e);
+    compared++;
+  }
+
+  void compare_speed(bool is_valid, double value, double reference, double t)
+  {
+    if(!is_valid || t < settle_seconds || std::abs(reference) < 0.1)
+      return;
+    speed_error_sum += std::abs(value - reference) / std::abs(reference);
+    speed_compared++;
+  }
+
+  result finish(double rate)
+  {
+    result r;
+    if(tick_ns.empty())
+      return r;
+
+    double total = 0.;
+    for(double ns : tick_ns)
+      total += ns;
+    std::sort(tick_ns.begin(), tick_ns.end());
+    const auto percentile = [&](double p) {
+      const auto i = std::min(tick_ns.size() - 1, std::size_t(p * tick_ns.size()));
+      return tick_ns[i] / 1e3;
+    };
+
+    r.realtime = samples / rate / (total / 1e9);
+    r.p50_us = percentile(0.5);
+    r.p99_us = percentile(0.99);
+    r.max_us = tick_ns.back() / 1e3;
+    r.valid = double(valid) / blocks;
+    r.mean_error_ms = compared ? error_sum / compared : std::nan("");
+    r.max_error_ms = compared ? error_max : std::nan("");
+    r.mean_speed_error = speed_compared ? speed_error_sum / speed_compared : std::nan("");
+    return r;
+  }
+};
+
+template <typename F>
+double time_ns(F&& f)
+{
+  const auto t0 = std::chrono::steady_clock::now();
+  f();
+  const auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count();
+}
+
+halp::setup make_setup(int inputs, int outputs, int frames, double rate)
+{
+  halp::setup setup{};
+  setup.input_channels = inputs;
+  setup.output_channels = outputs;
+  setup.frames = frames;
+  setup.rate = rate;
+  return setup;
+}
+
+halp::tick_flicks make_tick(int64_t position, int frames, double rate)
+{
+  halp::tick_flicks tk{};
+  tk.frames = frames;
+  tk.tempo = 120.;
+  tk.start_in_flicks = static_cast<int64_t>(position * flicks_per_second / rate);
+  tk.end_in_flicks
+      = static_cast<int64_t>((position + frames) * flicks_per_second / rate);
+  return tk;
+}
+
+result run_generator(double rate, int block)
+{
+  ao::LTCGenerator gen;
+  gen.prepare(make_setup(0, 1, block, rate));
+
+  std::vector<double> out(block);
+  gen.outputs.audio.channel = out.data();
+
+  statistics stats;
+  const auto n = static_cast<int64_t>(rate * corpus_seconds);
+  for(int64_t pos = 0; pos + block <= n; pos += block)
+  {
+    const auto tk = make_tick(pos, block, rate);
+    stats.tick(time_ns([&] { gen(tk); }), block);
+  }
+  return stats.finish(rate);
+}
+
+result run_ltc_input(const corpus& c, int block)
+{
+  ao::LTCInput input;
+  input.prepare(make_setup(1, 0, block, c.rate));
+
+  statistics stats;
+  const auto n = static_cast<int64_t>(c.channels[0].size());
+  for(int64_t pos = 0; pos + block <= n; pos += block)
+  {
+    input.inputs.audio.channel = const_cast<double*>(c.channels[0].data() + pos);
+    const auto tk = make_tick(pos, block, c.rate);
+    stats.tick(time_ns([&] { input(tk); }), block);
+    stats.compare(
+        input.outputs.valid, input.outputs.timecode, c.reference[pos], pos / c.rate);
+  }
+  return stats.finish(c.rate);
+}
+
+result run_dvs(const corpus& c, int format, ao::XWaxDVS::PitchFilter filter, int block)
+{
+  ao::XWaxDVS dvs;
+  dvs.inputs.vinyl_type.value = static_cast<ao::XWaxDVS::VinylType>(format);
+  dvs.inputs.pitch_filter.value = filter;
+  const auto setup = make_setup(2, 0, block, c.rate);
+  dvs.prepare(setup);
+
+  double* planes[2]{};
+  dvs.inputs.audio.samples = planes;
+  dvs.inputs.audio.channels = 2;
+
+  const auto n = static_cast<int64_t>(c.channels[0].size());
+  const auto submit = [&](int64_t pos) {
+    planes[0] = const_cast<double*>(c.channels[0].data() + pos);
+    planes[1] = const_cast<double*>(c.channels[1].data() + pos);
+    dvs(make_tick(pos, block, c.rate));
+  };
+
+  // The definition is loaded by the worker thread: wait until it decodes, then
+  // start over so that this is not measured
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  for(int64_t pos = 0;
+      !dvs.outputs.valid && std::chrono::steady_clock::now() < deadline;)
+  {
+    submit(pos);
+    pos = pos + 2 * block <= n ? pos + block : 0;
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  dvs.prepare(setup);
+
+  statistics stats;
+  for(int64_t pos = 0; pos + block <= n; pos += block)
+  {
+    stats.tick(time_ns([&] { submit(pos); }), block);
+    stats.compare(
+        dvs.outputs.valid, dvs.outputs.position, c.reference[pos + block - 1],
+        pos / c.rate);
+    if(!c.reference_speed.empty())
+      stats.compare_speed(
+          dvs.outputs.valid, dvs.outputs.speed, c.reference_speed[pos + block - 1],
+          pos / c.rate);
+  }
+  return stats.finish(c.rate);
+}
+
+// The same corpus on every deck but the idle ones, which are silent and gated:
+// the accuracy is that of the first one
+result run_multi_dvs(const corpus& c, int decks, int idle, bool parallel, int block)
+{
+  ao::XWaxMultiDVS multi;
+  multi.inputs.vinyl_type.value = static_cast<ao::XWaxDVS::VinylType>(c.format);
+  multi.inputs.parallel.value = parallel;
+  multi.inputs.gate.value = idle > 0 ? -50.f : ao::XWaxDVS::gate_off;
+  const auto setup = make_setup(2 * decks, 0, block, c.rate);
+  multi.prepare(setup);
+
+  std::vector<double*> planes(2 * decks);
+  multi.inputs.audio.samples = planes.data();
+  multi.inputs.audio.channels = 2 * decks;
+
+  const auto n = static_cast<int64_t>(c.channels[0].size());
+  std::vector<double> silence(block);
+  const auto submit = [&](int64_t pos) {
+    for(int d = 0; d < decks; d++)
+    {
+      const bool live = d < decks - idle;
+      planes[2 * d] = live ? const_cast<double*>(c.channels[0].data() + pos)
+                           : silence.data();
+      planes[2 * d + 1] = live ? const_cast<double*>(c.channels[1].data() + pos)
+                               : silence.data();
+    }
+    multi(make_tick(pos, block, c.rate));
+  };
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  for(int64_t pos = 0; multi.outputs.valid.value.size() < std::size_t(decks - idle)
+                       && std::chrono::steady_clock::now() < deadline;)
+  {
+    submit(pos);
+    pos = pos + 2 * block <= n ? pos + block : 0;
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  multi.prepare(setup);
+
+  statistics stats;
+  for(int64_t pos = 0; pos + block <= n; pos += block)
+  {
+    stats.tick(time_ns([&] { submit(pos); }), block);
+    const auto& valid = multi.outputs.valid.value;
+    const bool is_valid = !valid.empty() && valid.front() == 0;
+    stats.compare(
+        is_valid, multi.outputs.positions.value[0], c.reference[pos + block - 1],
+        pos / c.rate);
+    if(!c.reference_speed.empty())
+      stats.compare_speed(
+          is_valid, multi.outputs.speeds.value[0], c.reference_speed[pos + block - 1],
+          pos / c.rate);
+  }
+  return stats.finish(c.rate);
+}
+
+void print_header()
+{
+  std::printf(
+      "%-32s %7s %6s %9s %9s %9s %9s %7s %9s %9s %9s\n", "corpus", "rate", "block",
+      "x rt", "p50 (us)", "p99 (us)", "max (us)", "valid", "err (ms)", "max (ms)",
+      "speed err");
+}
+
+void print(const std::string& name, double rate, int block, const result& r)
+{
+  std::printf(
+      "%-32s %7.0f %6d %9.1f %9.2f %9.2f %9.2f %6.1f%% %9.3f %9.3f %8.3f%%\n",
+      name.c_str(), rate, block, r.realtime, r.p50_us, r.p99_us, r.max_us,
+      r.valid * 100., r.mean_error_ms, r.max_error_ms, r.mean_speed_error * 100.);
+}
+
+// Accuracy of the synthetic DVS corpora, by corpus, rate and block size. The
+// timings depend on the machine and are not part of it.
+struct baseline
+{
+  std::map<std::string, result> rows;
+
+  void add(const corpus& c, const std::string& name, int block, const result& r)
+  {
+    if(c.checked)
+      rows[name + '\t' + std::to_string(std::lround(c.rate)) + '\t'
+           + std::to_string(block)]
+          = r;
+  }
+
+  bool load(const char* path)
+  {
+    std::ifstream in{path};
+    std::string line;
+    while(std::getline(in, line))
+    {
+      if(line.empty() || line[0] == '#')
+        continue;
+
+      // The name has spaces: the columns are separated by tabs
+      const auto end = line.find('\t', line.find('\t', line.find('\t') + 1) + 1);
+      if(end == std::string::npos)
+        return false;
+
+      result r;
+      std::istringstream values{line.substr(end + 1)};
+      std::string valid, error, speed_error;
+      if(!(values >> valid >> error >> speed_error))
+        return false;
+      r.valid = std::strtod(valid.c_str(), nullptr);
+      r.mean_error_ms = std::strtod(error.c_str(), nullptr);
+      r.mean_speed_error = std::strtod(speed_error.c_str(), nullptr);
+      rows[line.substr(0, end)] = r;
+    }
+    return !rows.empty();
+  }
+
+  bool save(const char* path) const
+  {
+    std::FILE* f = std::fopen(path, "w");
+    if(!f)
+      return false;
+
+    std::fprintf(f, "# processors_bench --save-baseline\n");
+    std::fprintf(f, "# corpus\trate\tblock\tvalid\terr (ms)\tspeed err\n");
+    for(const auto& [key, r] : rows)
+    {
+      std::fprintf(
+          f, "%s\t%.4f\t%.4f\t%.5f\n", key.c_str(), r.valid, r.mean_error_ms,
+          r.mean_speed_error);
+    }
+    return std::fclose(f) == 0;
+  }
+};
+
+// How much worse than the baseline a row may be: the noise of the corpora comes
+// from the standard library, whose distributions differ across implementations
+constexpr double valid_tolerance = 0.01;
+constexpr double error_tolerance = 0.1;
+constexpr double error_tolerance_ms = 0.05;
+constexpr double speed_error_tolerance = 0.005;
+
+// Returns false if a row of the baseline was not run or is worse
+bool compare(const baseline& expected, const baseline& measured)
+{
+  // NaN when nothing was compared in the baseline: anything is as good
+  const auto worse = [](double value, double reference, double tolerance) {
+    return !std::isnan(reference) && !(value <= reference + tolerance);
+  };
+
+  int failures = 0;
+  for(const auto& [key, e] : expected.rows)
+  {
+    auto it = measured.rows.find(key);
+    if(it == measured.rows.end())
+    {
+      std::fprintf(stderr, "baseline: %s was not run\n", key.c_str());
+      failures++;
+      continue;
+    }
+
+    const result& r = it->second;
+    if(r.valid < e.valid - valid_tolerance
+       || worse(
+           r.mean_error_ms, e.mean_error_ms,
+           e.mean_error_ms * error_tolerance + error_tolerance_ms)
+       || worse(r.mean_speed_error, e.mean_speed_error, speed_error_tolerance))
+    {
+      std::fprintf(
+          stderr,
+          "baseline: %s: valid %.1f%% err %.3f ms speed err %.3f%%, "
+          "expected %.1f%% %.3f ms %.3f%%\n",
+          key.c_str(), r.valid * 100., r.mean_error_ms, r.mean_speed_error * 100.,
+          e.valid * 100., e.mean_error_ms, e.mean_speed_error * 100.);
+      failures++;
+    }
+  }
+
+  std::fprintf(
+      stderr, "baseline: %zu rows, %d worse or missing\n", expected.rows.size(),
+      failures);
+  return failures == 0;
+}
+
+constexpr std::pair<ao::XWaxDVS::PitchFilter, const char*> pitch_filters[]
+    = {{ao::XWaxDVS::Kalman, "kalman"},
+       {ao::XWaxDVS::AlphaBeta, "alpha-beta"},
+       {ao::XWaxDVS::KalmanFast, "kalman-fast"}};
+
+void print_dvs(const corpus& c, int block, baseline& measured)
+{
+  for(auto [filter, name] : pitch_filters)
+  {
+    const auto r = run_dvs(c, c.format, filter, block);
+    print(c.name + " " + name, c.rate, block, r);
+    measured.add(c, c.name + " " + name, block, r);
+  }
+}
+}
+
+int main(int argc, char** argv)
+{
+  std::vector<corpus> recorded;
+  baseline expected, measured;
+  const char* baseline_path = nullptr;
+  const char* save_path = nullptr;
+  for(int i = 1; i < argc; i++)
+  {
+    corpus c;
+    if(!std::strcmp(argv[i], "--ltc") && i + 1 < argc)
+    {
+      c.name = argv[++i];
+    }
+    else if(!std::strcmp(argv[i], "--dvs") && i + 2 < argc)
+    {
+      const char* format = argv[++i];
+      for(int f = 0; f < ao::XWaxDefinitions::count; f++)
+        if(!std::strcmp(format, ao::XWaxDefinitions::name(f)))
+          c.format = f;
+      c.name = argv[++i];
+      if(c.format < 0)
+      {
+        std::fprintf(stderr, "unknown DVS format %s\n", format);
+        return 1;
+      }
+    }
+    else if(!std::strcmp(argv[i], "--lut-dir") && i + 1 < argc)
+    {
+      ao::XWaxDefinitions::set_cache_directory(argv[++i]);
+      continue;
+    }
+    else if(!std::strcmp(argv[i], "--baseline") && i + 1 < argc)
+    {
+      baseline_path = argv[++i];
+      if(!expected.load(baseline_path))
+      {
+        std::fprintf(stderr, "cannot read the baseline %s\n", baseline_path);
+        return 1;
+      }
+      continue;
+    }
+    else if(!std::strcmp(argv[i], "--save-baseline") && i + 1 < argc)
+    {
+      save_path = argv[++i];
+      continue;
+    }
+    else
+    {
+      std::fprintf(
+          stderr,
+          "usage: processors_bench [--ltc file.wav] [--dvs format file.wav] "
+          "[--lut-dir dir] [--baseline file | --save-baseline file]\n");
+      return 1;
+    }
+
+    if(!load_corpus(c, c.name.c_str()))
+    {
+      std::fprintf(stderr, "cannot read %s\n", c.name.c_str());
+      return 1;
+    }
+    recorded.push_back(std::move(c));
+  }
+
+  print_header();
+  for(double rate : sample_rates)
+    for(int block : block_sizes)
+      print("LTCGenerator", rate, block, run_generator(rate, block));
+
+  for(double rate : sample_rates)
+  {
+    for(double speed : {1., 0.5, 1.5})
+    {
+      const auto c = ltc_corpus(rate, speed);
+      for(int block : block_sizes)
+        print(c.name, rate, block, run_ltc_input(c, block));
+    }
+  }
+
+  // Serato 2A, Traktor A, Traktor MK2 A and MixVibes V2
+  constexpr int dvs_formats[] = {0, 3, 5, 8};
+  for(double rate : {44100., 96000.})
+  {
+    for(int format : dvs_formats)
+    {
+      for(bool scratch : {false, true})
+      {
+        const auto c = dvs_corpus(rate, format, scratch);
+        for(int block : block_sizes)
+          print_dvs(c, block, measured);
+
+        if(rate == 44100. && !scratch)
+        {
+          for(int block : block_sizes)
+          {
+            const std::pair<const char*, result> runs[]{
+                {" x4 serial", run_multi_dvs(c, 4, 0, false, block)},
+                {" x4 pool", run_multi_dvs(c, 4, 0, true, block)},
+                {" x4 2 idle serial", run_multi_dvs(c, 4, 2, false, block)}};
+            for(const auto& [suffix, r] : runs)
+            {
+              print(c.name + suffix, rate, block, r);
+              measured.add(c, c.name + suffix, block, r);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  for(const auto& c : recorded)
+  {
+    for(int block : block_sizes)
+    {
+      if(c.format >= 0)
+        print_dvs(c, block, measured);
+      else
+        print(c.name, c.rate, block, run_ltc_input(c, block));
+    }
+  }
+
+  if(save_path && !measured.save(save_path))
+  {
+    std::fprintf(stderr, "cannot write the baseline %s\n", save_path);
+    return 1;
+  }
+  if(baseline_path && !compare(expected, measured))
+    return 1;
+  return 0;
+}
@@ -0,0 +1,225 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+/**
+ * Lookup latency and memory of the xwax timecode tables, per format.
+ *
+ * The open-addressing tables of lut.c / lut_mk2.c are compared against the
+ * former 16-bit-hash chained tables, rebuilt here from the same timecodes.
+ */
+
+// lut.h and lut_mk2.h have no C++ guards of their own
+extern "C" {
+#include <timecoder.h>
+}
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+constexpr const char* formats[] = {
+    "serato_2a",     "serato_2b",     "serato_cd",      "traktor_a",
+    "traktor_b",     "traktor_mk2_a", "traktor_mk2_b",  "traktor_mk2_cd",
+    "mixvibes_v2", "mixvibes_7inch", "pioneer_a",      "pioneer_b",
+};
+
+constexpr int lookups = 2'000'000;
+constexpr slot_no_t no_slot = LUT_NO_SLOT;
+
+// Former layout: 16-bit hash -> singly-linked chain of slots
+template <typename Timecode, typename Hash, typename Eq>
+struct chained_lut
+{
+  struct slot
+  {
+    Timecode timecode;
+    slot_no_t next;
+  };
+  std::vector<slot> slots;
+  std::vector<slot_no_t> table = std::vector<slot_no_t>(1 << 16, no_slot);
+
+  void push(const Timecode& tc)
+  {
+    const auto h = Hash{}(tc);
+    slots.push_back({tc, table[h]});
+    table[h] = slots.size() - 1;
+  }
+
+  slot_no_t lookup(const Timecode& tc) const
+  {
+    for(slot_no_t n = table[Hash{}(tc)]; n != no_slot; n = slots[n].next)
+      if(Eq{}(slots[n].timecode, tc))
+        return n;
+    return no_slot;
+  }
+
+  std::size_t bytes() const
+  {
+    return slots.size() * sizeof(slot) + table.size() * sizeof(slot_no_t);
+  }
+};
+
+struct hash16
+{
+  unsigned operator()(bits_t tc) const noexcept { return tc & 0xffff; }
+};
+struct hash110
+{
+  unsigned operator()(const mk2bits_t& v) const noexcept
+  {
+    auto hash = (unsigned short)(v.low ^ (v.low >> 16) ^ (v.low >> 32) ^ (v.low >> 48));
+    hash ^= (unsigned short)(v.high ^ (v.high << 5) ^ (v.high >> 3));
+    hash ^= (hash >> 7) ^ (hash << 9);
+    return hash;
+  }
+};
+struct eq
+{
+  bool operator()(bits_t a, bits_t b) const noexcept { return a == b; }
+  bool operator()(const mk2bits_t& a, const mk2bits_t& b) const noexcept
+  {
+    return u128_eq(a, b);
+  }
+};
+
+// Half of the queries hit a random slot, half miss
+template <typename Timecode>
+std::vector<Timecode> make_queries(const std::vector<Timecode>& timecodes)
+{
+  std::mt19937_64 rng{1234};
+  std::uniform_int_distribution<std::size_t> pick(0, timecodes.size() - 1);
+  std::vector<Timecode> queries;
+  queries.reserve(lookups);
+  for(int i = 0; i < lookups; i++)
+  {
+    Timecode tc = timecodes[pick(rng)];
+    if(i % 2)
+    {
+      if constexpr(std::is_same_v<Timecode, bits_t>)
+        tc = ~tc;
+      else
+        tc.high = ~tc.high;
+    }
+    queries.push_back(tc);
+  }
+  return queries;
+}
+
+template <typename F>
+double ns_per_lookup(F&& f, unsigned& checksum)
+{
+  const auto t0 = std::chrono::steady_clock::now();
+  checksum += f();
+  const auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / lookups;
+}
+
+void report(
+    const char* name, std::size_t n, double chained_ns, std::size_t chained_bytes,
+    double open_ns, std::size_t open_bytes)
+{
+  std::printf(
+      "%-16s %8zu %10.1f %10.1f %12zu %12zu\n", name, n, chained_ns, open_ns,
+      chained_bytes / 1024, open_bytes / 1024);
+}
+
+void bench_plain(const char* name, timecode_def* def, unsigned& checksum)
+{
+  // The buckets hold every (timecode, slot) pair
+  const auto& lut = def->lut;
+  std::vector<bits_t> timecodes(lut.avail);
+  for(slot_no_t n = 0; n <= lut.mask; n++)
+    if(lut.table[n].slot != no_slot)
+      timecodes[lut.table[n].slot] = lut.table[n].timecode;
+
+  chained_lut<bits_t, hash16, eq> chained;
+  for(auto tc : timecodes)
+    chained.push(tc);
+
+  const auto queries = make_queries(timecodes);
+  const double chained_ns = ns_per_lookup(
+      [&] {
+    unsigned sum = 0;
+    for(auto q : queries)
+      sum += chained.lookup(q);
+    return sum;
+      },
+      checksum);
+  const double open_ns = ns_per_lookup(
+      [&] {
+    unsigned sum = 0;
+    for(auto q : queries)
+      sum += lut_lookup(&lut, q);
+    return sum;
+      },
+      checksum);
+
+  report(
+      name, timecodes.size(), chained_ns, chained.bytes(), open_ns,
+      sizeof(lut_entry) * (lut.mask + 1));
+}
+
+void bench_mk2(const char* name, timecode_def* def, unsigned& checksum)
+{
+  const auto& lut = def->lut_mk2;
+  std::vector<mk2bits_t> timecodes(lut.slot, lut.slot + lut.avail);
+
+  chained_lut<mk2bits_t, hash110, eq> chained;
+  for(auto& tc : timecodes)
+    chained.push(tc);
+
+  const auto queries = make_queries(timecodes);
+  const double chained_ns = ns_per_lookup(
+      [&] {
+    unsigned sum = 0;
+    for(auto& q : queries)
+      sum += chained.lookup(q);
+    return sum;
+      },
+      checksum);
+  const double open_ns = ns_per_lookup(
+      [&] {
+    unsigned sum = 0;
+    for(auto& q : queries)
+      sum += lut_lookup_mk2(&lut, &q);
+    return sum;
+      },
+      checksum);
+
+  report(
+      name, timecodes.size(), chained_ns, chained.bytes(), open_ns,
+      sizeof(mk2bits_t) * lut.avail + sizeof(lut_mk2_entry) * (lut.mask + 1));
+}
+}
+
+int main()
+{
+  unsigned checksum = 0;
+
+  std::printf(
+      "%-16s %8s %10s %10s %12s %12s\n", "format", "slots", "chain ns", "open ns",
+      "chain KiB", "open KiB");
+  for(auto name : formats)
+  {
+    auto def = timecoder_find_definition(name, nullptr);
+    if(!def)
+    {
+      std::fprintf(stderr, "Could not load %s\n", name);
+      continue;
+    }
+
+    if(def->flags & TRAKTOR_MK2)
+      bench_mk2(name, def, checksum);
+    else
+      bench_plain(name, def, checksum);
+
+    timecoder_free_definition(def);
+  }
+
+  std::printf("(checksum %u)\n", checksum);
+  return 0;
+}
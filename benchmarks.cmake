@@ -0,0 +1,49 @@
+add_executable(xwax_lut_bench "${CMAKE_CURRENT_SOURCE_DIR}/bench/xwax_lut_bench.cpp")
+target_link_libraries(xwax_lut_bench PRIVATE xwax::xwax)
+
+find_package(Boost REQUIRED)
+add_executable(ltc_generator_bench
+  "${CMAKE_CURRENT_SOURCE_DIR}/bench/ltc_generator_bench.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/LTCEncoder.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/LTCBiphase.cpp"
+)
+target_include_directories(ltc_generator_bench PRIVATE "${CMAKE_CURRENT_SOURCE_DIR}")
+target_compile_features(ltc_generator_bench PRIVATE cxx_std_20)
+target_link_libraries(ltc_generator_bench PRIVATE ltc::ltc Boost::boost)
+
+find_package(Threads REQUIRED)
+add_executable(processors_bench
+  "${CMAKE_CURRENT_SOURCE_DIR}/bench/processors_bench.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/LTC.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/LTCEncoder.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/LTCBiphase.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/LTCDecoderRequest.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/TimecodeTracker.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/XWax.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/XWaxDefinitions.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/Worker.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/WorkerPool.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/XWaxMulti.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/tools/ltc_analyze/WavReader.cpp"
+)
+target_include_directories(processors_bench PRIVATE "${CMAKE_CURRENT_SOURCE_DIR}")
+target_compile_features(processors_bench PRIVATE cxx_std_20)
+
+# The processors need the halp headers, which come with the avendish plug-in
+target_link_libraries(processors_bench
+  PRIVATE score_plugin_avnd ltc::ltc xwax::xwax Qt::Core Threads::Threads
+)
+
+# Exits with 1 if the MTC Output scheduling is off
+add_executable(mtc_scheduler_check
+  "${CMAKE_CURRENT_SOURCE_DIR}/bench/mtc_scheduler_check.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/MTCOutput.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/LTCDecoderRequest.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/TimecodeTracker.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/Worker.cpp"
+)
+target_include_directories(mtc_scheduler_check PRIVATE "${CMAKE_CURRENT_SOURCE_DIR}")
+target_compile_features(mtc_scheduler_check PRIVATE cxx_std_20)
+target_link_libraries(mtc_scheduler_check
+  PRIVATE score_plugin_avnd ltc::ltc Qt::Core Threads::Threads
+)
@@ -0,0 +1,11 @@
+add_executable(ltc_analyze
+  "${CMAKE_CURRENT_SOURCE_DIR}/tools/ltc_analyze/main.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/tools/ltc_analyze/Analysis.hpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/tools/ltc_analyze/Analysis.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/tools/ltc_analyze/WavReader.hpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/tools/ltc_analyze/WavReader.cpp"
+  "${CMAKE_CURRENT_SOURCE_DIR}/LTC/TimecodeIndex.cpp"
+)
+target_include_directories(ltc_analyze PRIVATE "${CMAKE_CURRENT_SOURCE_DIR}")
+target_compile_features(ltc_analyze PRIVATE cxx_std_20)
+target_link_libraries(ltc_analyze PRIVATE ltc::ltc xwax::xwax Threads::Threads)
@@ -0,0 +1,273 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "Analysis.hpp"
+
+#include "WavReader.hpp"
+
+#include <LTC/LTCSamples.hpp>
+
+#include <ltc.h>
+#include <timecoder.h>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace ao
+{
+namespace
+{
+// Beyond this, two points are a jump rather than a run
+constexpr double max_speed = 10.;
+
+struct segment
+{
+  int64_t begin{};
+  int64_t end{};
+  std::vector<TimecodePoint> points;
+  bool ok{};
+};
+
+struct ltc_segment_decoder
+{
+  struct raw_frame
+  {
+    int64_t sample;
+    SMPTETimecode tc;
+    bool drop_frame;
+  };
+
+  explicit ltc_segment_decoder(const AnalysisOptions& options, double rate)
+      : m_channel{options.channel}
+      , m_decoder{ltc_decoder_create(static_cast<int>(rate / 30.), queue_size)}
+  {
+  }
+
+  ~ltc_segment_decoder() { ltc_decoder_free(m_decoder); }
+
+  bool ok(int channels) const noexcept { return m_decoder && m_channel < channels; }
+
+  void write(const double* const* in, int n, int64_t position)
+  {
+    // The queue is drained often enough that it cannot overflow
+    for(int done = 0; done < n; done += ltc_chunk_size)
+    {
+      const int count = std::min(n - done, ltc_chunk_size);
+      const double* block = in[m_channel] + done;
+      ltc_decoder_write_block(
+          m_decoder, block, count, position + done, ltc_block_peak(block, count));
+
+      LTCFrameExt frame;
+      while(ltc_decoder_read(m_decoder, &frame) > 0)
+      {
+        raw_frame f{};
+        f.sample = frame.reverse ? frame.off_end : frame.off_start;
+        f.drop_frame = frame.ltc.dfbit != 0;
+        ltc_frame_to_time(&f.tc, &frame.ltc, 0);
+        m_max_frame = std::max(m_max_frame, int(f.tc.frame));
+        m_frames.push_back(f);
+      }
+    }
+  }
+
+  void finish(std::vector<TimecodePoint>& points)
+  {
+    for(const auto& f : m_frames)
+    {
+      const auto rate = detect_timecode_rate(f.drop_frame, m_max_frame);
+      const double seconds
+          = timecode_seconds(f.tc.hours, f.tc.mins, f.tc.secs, f.tc.frame, rate);
+      points.push_back({f.sample, seconds, float(rate.fps()), f.drop_frame});
+    }
+  }
+
+private:
+  static constexpr int queue_size = 32;
+
+  int m_channel{};
+  LTCDecoder* m_decoder{};
+  std::vector<raw_frame> m_frames;
+  int m_max_frame{};
+};
+
+struct dvs_segment_decoder
+{
+  explicit dvs_segment_decoder(const AnalysisOptions& options, double rate)
+      : m_rate{rate}
+      , m_step{std::max(1, static_cast<int>(rate * dvs_interval))}
+  {
+    timecoder_init(
+        &m_timecoder, options.dvs, options.dvs_speed, static_cast<unsigned int>(rate),
+        false, TIMECODER_PITCH_KALMAN);
+  }
+
+  ~dvs_segment_decoder() { timecoder_clear(&m_timecoder); }
+
+  bool ok(int channels) const noexcept { return channels >= 2; }
+
+  // The position is read every 10 ms, and dated from the last bit that was decoded
+  void write(const double* const* in, int n, int64_t position)
+  {
+    for(int done = 0; done < n; done += m_step)
+    {
+      const int count = std::min(n - done, m_step);
+      timecoder_submit_double(&m_timecoder, in[0] + done, in[1] + done, count);
+
+      double when = 0.;
+      const signed int ms = timecoder_get_position(&m_timecoder, &when);
+      if(ms < 0)
+        continue;
+
+      const int64_t sample = position + done + count - std::llround(when * m_rate);
+      if(!m_points.empty() && m_points.back().sample == sample)
+        continue;
+      m_points.push_back({sample, ms / 1000., 0.f, false});
+    }
+  }
+
+  void finish(std::vector<TimecodePoint>& points)
+  {
+    points.insert(points.end(), m_points.begin(), m_points.end());
+  }
+
+private:
+  timecoder m_timecoder{};
+  double m_rate{};
+  int m_step{};
+  std::vector<TimecodePoint> m_points;
+};
+
+template <typename Decoder>
+void decode_segment(const AnalysisOptions& options, int64_t frames, segment& s)
+{
+  WavReader reader;
+  if(!reader.open(options.path))
+    return;
+
+  const auto overlap = static_cast<int64_t>(options.overlap * reader.rate());
+  Decoder decoder{options, reader.rate()};
+  if(!decoder.ok(reader.channels()))
+    return;
+
+  const int channels = reader.channels();
+  std::vector<double> buffer(size_t(channels) * options.chunk_size);
+  std::vector<double*> planes(channels);
+  for(int c = 0; c < channels; c++)
+    planes[c] = buffer.data() + size_t(c) * options.chunk_size;
+
+  const int64_t stop = std::min(frames, s.end + overlap);
+  for(int64_t pos = std::max(int64_t(0), s.begin - overlap); pos < stop;)
+  {
+    const auto count = std::min<int64_t>(options.chunk_size, stop - pos);
+    const int n = reader.read(pos, planes.data(), static_cast<int>(count));
+    if(n <= 0)
+      break;
+    decoder.write(planes.data(), n, pos);
+    pos += n;
+  }
+
+  std::vector<TimecodePoint> points;
+  decoder.finish(points);
+  std::sort(points.begin(), points.end(), [](const auto& a, const auto& b) {
+    return a.sample < b.sample;
+  });
+  for(const auto& p : points)
+    if(p.sample >= s.begin && p.sample < s.end)
+      s.points.push_back(p);
+  s.ok = true;
+}
+}
+
+bool analyze(
+    const AnalysisOptions& options, double& rate, std::vector<TimecodePoint>& points)
+{
+  WavReader reader;
+  if(!reader.open(options.path))
+    return false;
+  rate = reader.rate();
+
+  const int64_t frames = reader.frames();
+  const int threads = options.threads > 0
+                          ? options.threads
+                          : std::max(1, int(std::thread::hardware_concurrency()));
+  const auto min_segment
+      = std::max(int64_t(1), static_cast<int64_t>(options.min_segment * rate));
+  const auto count = static_cast<int>(
+      std::clamp(frames / min_segment, int64_t(1), int64_t(threads)));
+
+  std::vector<segment> segments(count);
+  for(int i = 0; i < count; i++)
+  {
+    segments[i].begin = frames * i / count;
+    segments[i].end = frames * (i + 1) / count;
+  }
+
+  std::vector<std::thread> workers;
+  workers.reserve(count);
+  for(auto& s : segments)
+  {
+    workers.emplace_back([&options, frames, &s] {
+      if(options.dvs)
+        decode_segment<dvs_segment_decoder>(options, frames, s);
+      else
+        decode_segment<ltc_segment_decoder>(options, frames, s);
+    });
+  }
+  for(auto& w : workers)
+    w.join();
+
+  points.clear();
+  for(const auto& s : segments)
+  {
+    if(!s.ok)
+      return false;
+    points.insert(points.end(), s.points.begin(), s.points.end());
+  }
+  return true;
+}
+
+std::vector<TimecodeIndexRun>
+compact(const std::vector<TimecodePoint>& points, double rate, double tolerance)
+{
+  std::vector<TimecodeIndexRun> runs;
+  int run_points = 0;
+  for(const auto& p : points)
+  {
+    if(!runs.empty())
+    {
+      auto& r = runs.back();
+      const double elapsed = (p.sample - r.sample) / rate;
+      if(elapsed > 0. && r.fps == p.fps && r.drop_frame == p.drop_frame)
+      {
+        const double speed = (p.seconds - r.seconds) / elapsed;
+        const bool extends
+            = run_points == 1
+                  ? std::abs(speed) <= max_speed
+                  : std::abs(r.seconds + elapsed * r.speed - p.seconds) <= tolerance;
+        if(extends)
+        {
+          r.length = p.sample - r.sample;
+          r.speed = speed;
+          run_points++;
+          continue;
+        }
+      }
+    }
+
+    runs.push_back({p.sample, 0, p.seconds, 1., p.fps, p.drop_frame, {}});
+    run_points = 1;
+  }
+
+  // Without going past the start of the next run
+  for(std::size_t i = 0; i < runs.size(); i++)
+  {
+    auto& r = runs[i];
+    const double last = r.fps > 0. ? rate / r.fps / std::max(std::abs(r.speed), 0.1)
+                                   : rate * dvs_interval;
+    r.length += std::llround(last);
+    if(i + 1 < runs.size())
+      r.length = std::min(r.length, runs[i + 1].sample - r.sample);
+  }
+  return runs;
+}
+}
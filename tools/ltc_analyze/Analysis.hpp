@@ -0,0 +1,68 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <LTC/TimecodeIndex.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct timecode_def;
+
+namespace ao
+{
+// A timecode read in the file, at the sample where it starts
+struct TimecodePoint
+{
+  int64_t sample{};
+  double seconds{};
+  float fps{};
+  bool drop_frame{};
+};
+
+// DVS positions are read this often, in seconds of audio
+static constexpr double dvs_interval = 0.01;
+
+struct AnalysisOptions
+{
+  std::string path;
+
+  // LTC is read from this channel. DVS uses the first two channels.
+  int channel{0};
+
+  // Decodes DVS with this definition instead of LTC
+  timecode_def* dvs{};
+  double dvs_speed{1.};
+
+  // 0 for one thread per core
+  int threads{0};
+
+  // In seconds. Segments are no shorter than min_segment, and each segment also
+  // decodes `overlap` seconds on both sides so that the decoders are locked at its
+  // boundaries; the points in the overlap belong to the neighbours.
+  double min_segment{300.};
+  double overlap{2.};
+
+  // Frames read from the file at once
+  int chunk_size{1 << 16};
+};
+
+/**
+ * @brief Decodes a whole file, in parallel segments
+ *
+ * The points of every segment are kept from its start to its end, which stitches
+ * them into a single list ordered by sample. The LTC frame rate is found from the
+ * highest frame number in each segment.
+ *
+ * Returns false if the file cannot be read.
+ */
+bool analyze(
+    const AnalysisOptions& options, double& rate, std::vector<TimecodePoint>& points);
+
+// Merges the points into runs. A point extends the current run when it is less
+// than `tolerance` seconds away from the timecode the run predicts at its sample.
+// A run ends one LTC frame, or one DVS interval, after its last point.
+std::vector<TimecodeIndexRun>
+compact(const std::vector<TimecodePoint>& points, double rate, double tolerance);
+}
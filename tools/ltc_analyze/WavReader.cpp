@@ -0,0 +1,135 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "WavReader.hpp"
+
+#include <cstring>
+
+namespace ao
+{
+
+static uint32_t read_u32(const unsigned char* p) noexcept
+{
+  return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16
+         | uint32_t(p[3]) << 24;
+}
+
+static uint16_t read_u16(const unsigned char* p) noexcept
+{
+  return uint16_t(p[0] | p[1] << 8);
+}
+
+bool WavReader::open(const std::string& path)
+{
+  m_file.open(path, std::ios::binary);
+  if(!m_file)
+    return false;
+
+  unsigned char riff[12];
+  if(!m_file.read(reinterpret_cast<char*>(riff), 12) || std::memcmp(riff, "RIFF", 4)
+     || std::memcmp(riff + 8, "WAVE", 4))
+    return false;
+
+  bool has_format = false;
+  unsigned char header[8];
+  while(m_file.read(reinterpret_cast<char*>(header), 8))
+  {
+    const uint32_t size = read_u32(header + 4);
+    if(!std::memcmp(header, "fmt ", 4) && size >= 16)
+    {
+      std::vector<unsigned char> fmt(size);
+      if(!m_file.read(reinterpret_cast<char*>(fmt.data()), size))
+        return false;
+
+      uint16_t tag = read_u16(fmt.data());
+      m_channels = read_u16(fmt.data() + 2);
+      m_rate = read_u32(fmt.data() + 4);
+      m_bytes = read_u16(fmt.data() + 14) / 8;
+
+      // WAVE_FORMAT_EXTENSIBLE: the actual format is the start of the sub-format GUID
+      if(tag == 0xFFFE && size >= 26)
+        tag = read_u16(fmt.data() + 24);
+
+      if(tag == 3)
+        m_float = true;
+      else if(tag != 1)
+        return false;
+
+      if(m_float ? (m_bytes != 4 && m_bytes != 8) : (m_bytes < 1 || m_bytes > 4))
+        return false;
+      has_format = m_channels > 0 && m_rate > 0;
+    }
+    else if(!std::memcmp(header, "data", 4))
+    {
+      if(!has_format)
+        return false;
+      m_data_offset = m_file.tellg();
+
+      // Recorders that are interrupted leave a data size of 0 or too large
+      m_file.seekg(0, std::ios::end);
+      int64_t bytes = int64_t(m_file.tellg()) - m_data_offset;
+      if(size > 0 && size < bytes)
+        bytes = size;
+      m_frames = bytes / (m_bytes * m_channels);
+      return true;
+    }
+    else
+    {
+      // Chunks are padded to an even size
+      m_file.seekg(size + (size & 1), std::ios::cur);
+    }
+  }
+  return false;
+}
+
+int WavReader::read(int64_t start, double* const* out, int n)
+{
+  if(start >= m_frames || n <= 0)
+    return 0;
+  if(n > m_frames - start)
+    n = int(m_frames - start);
+
+  const int frame_bytes = m_bytes * m_channels;
+  m_buffer.resize(size_t(n) * frame_bytes);
+  m_file.clear();
+  m_file.seekg(m_data_offset + start * frame_bytes);
+  m_file.read(reinterpret_cast<char*>(m_buffer.data()), m_buffer.size());
+  n = int(m_file.gcount() / frame_bytes);
+
+  const unsigned char* p = m_buffer.data();
+  for(int i = 0; i < n; i++)
+  {
+    for(int c = 0; c < m_channels; c++, p += m_bytes)
+    {
+      double v{};
+      if(m_float)
+      {
+        if(m_bytes == 4)
+        {
+          float f;
+          std::memcpy(&f, p, 4);
+          v = f;
+        }
+        else
+        {
+          std::memcpy(&v, p, 8);
+        }
+      }
+      else if(m_bytes == 1)
+      {
+        // 8-bit WAV is unsigned
+        v = (int(p[0]) - 128) / 128.;
+      }
+      else
+      {
+        // Left-align in 32 bits so that the sign is the one of the sample
+        uint32_t u = 0;
+        for(int b = 0; b < m_bytes; b++)
+          u |= uint32_t(p[b]) << (8 * (4 - m_bytes + b));
+        v = int32_t(u) / 2147483648.;
+      }
+      out[c][i] = v;
+    }
+  }
+  return n;
+}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ao
+{
+/**
+ * @brief Minimal streaming reader for WAV files
+ *
+ * Integer PCM from 8 to 32 bits and 32 / 64-bit float, including
+ * WAVE_FORMAT_EXTENSIBLE. Reads are positioned, so that several readers can decode
+ * different parts of the same file in parallel.
+ */
+class WavReader
+{
+public:
+  bool open(const std::string& path);
+
+  int channels() const noexcept { return m_channels; }
+  double rate() const noexcept { return m_rate; }
+  int64_t frames() const noexcept { return m_frames; }
+
+  // Reads up to n frames from `start` into the planar buffers out[0..channels()),
+  // as doubles in [-1; 1]. Returns the number of frames read.
+  int read(int64_t start, double* const* out, int n);
+
+private:
+  std::ifstream m_file;
+  std::vector<unsigned char> m_buffer;
+  int64_t m_data_offset{};
+  int64_t m_frames{};
+  double m_rate{};
+  int m_channels{};
+  int m_bytes{};
+  bool m_float{};
+};
+}
@@ -0,0 +1,132 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+/**
+ * Offline timecode analysis of an audio file.
+ *
+ *   ltc_analyze [options] input.wav output.idx
+ *
+ * Decodes the LTC, or the DVS timecode, of the whole file in parallel and writes
+ * the sample -> timecode runs found in it as a TimecodeIndex, or with --text one
+ * per line:
+ *
+ *   sample length seconds speed fps drop_frame
+ */
+
+#include "Analysis.hpp"
+
+#include <timecoder.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace
+{
+void usage()
+{
+  std::fprintf(
+      stderr,
+      "usage: ltc_analyze [options] input.wav output.idx\n"
+      "Writes the sample -> timecode runs as a binary TimecodeIndex.\n"
+      "  --channel N     channel with the LTC (default 0)\n"
+      "  --dvs FORMAT    decode DVS timecode instead, e.g. serato_2a\n"
+      "  --speed S       DVS speed multiplier, 1.35 for 45 rpm (default 1)\n"
+      "  --lut-dir DIR   cache directory for the DVS lookup tables\n"
+      "  --threads N     decoding threads (default: one per core)\n"
+      "  --text          write the runs as text, one per line, instead\n");
+}
+}
+
+int main(int argc, char** argv)
+{
+  ao::AnalysisOptions options;
+  const char* format = nullptr;
+  const char* lut_dir = nullptr;
+  const char* output = nullptr;
+  bool text = false;
+
+  for(int i = 1; i < argc; i++)
+  {
+    const bool has_value = i + 1 < argc;
+    if(!std::strcmp(argv[i], "--channel") && has_value)
+      options.channel = std::atoi(argv[++i]);
+    else if(!std::strcmp(argv[i], "--dvs") && has_value)
+      format = argv[++i];
+    else if(!std::strcmp(argv[i], "--speed") && has_value)
+      options.dvs_speed = std::atof(argv[++i]);
+    else if(!std::strcmp(argv[i], "--lut-dir") && has_value)
+      lut_dir = argv[++i];
+    else if(!std::strcmp(argv[i], "--threads") && has_value)
+      options.threads = std::atoi(argv[++i]);
+    else if(!std::strcmp(argv[i], "--text"))
+      text = true;
+    else if(argv[i][0] == '-')
+      return usage(), EXIT_FAILURE;
+    else if(options.path.empty())
+      options.path = argv[i];
+    else
+      output = argv[i];
+  }
+
+  if(options.path.empty() || !output || options.channel < 0)
+    return usage(), EXIT_FAILURE;
+
+  if(format)
+  {
+    options.dvs = timecoder_find_definition(format, lut_dir);
+    if(!options.dvs)
+    {
+      std::fprintf(stderr, "ltc_analyze: unknown DVS format %s\n", format);
+      return EXIT_FAILURE;
+    }
+  }
+
+  double rate{};
+  std::vector<ao::TimecodePoint> points;
+  const bool ok = ao::analyze(options, rate, points);
+  if(options.dvs)
+    timecoder_free_definition(options.dvs);
+  if(!ok)
+  {
+    std::fprintf(stderr, "ltc_analyze: cannot decode %s\n", options.path.c_str());
+    return EXIT_FAILURE;
+  }
+
+  // Half a frame for LTC, a few milliseconds for the millisecond DVS positions
+  const double tolerance = options.dvs ? 0.003 : 0.5 / 30.;
+  const auto runs = ao::compact(points, rate, tolerance);
+
+  std::FILE* f = std::fopen(output, text ? "w" : "wb");
+  if(!f)
+  {
+    std::fprintf(stderr, "ltc_analyze: cannot write %s\n", output);
+    return EXIT_FAILURE;
+  }
+
+  if(text)
+  {
+    std::fprintf(f, "# rate %g\n", rate);
+    for(const auto& r : runs)
+    {
+      std::fprintf(
+          f, "%lld %lld %.6f %.6f %g %d\n", (long long)r.sample, (long long)r.length,
+          r.seconds, r.speed, r.fps, int(r.drop_frame));
+    }
+  }
+  else
+  {
+    const auto index = ao::TimecodeIndex::build(rate, runs);
+    std::fwrite(index.data(), 1, index.size(), f);
+  }
+
+  if(std::fclose(f) != 0)
+  {
+    std::fprintf(stderr, "ltc_analyze: cannot write %s\n", output);
+    return EXIT_FAILURE;
+  }
+
+  std::fprintf(
+      stderr, "ltc_analyze: %zu timecodes, %zu runs\n", points.size(), runs.size());
+  return EXIT_SUCCESS;
+}
@@ -3,6 +3,7 @@ if(NOT TARGET xwax)
     "${CMAKE_CURRENT_SOURCE_DIR}/3rdparty/xwax/delayline.c"
     "${CMAKE_CURRENT_SOURCE_DIR}/3rdparty/xwax/filters.c"
     "${CMAKE_CURRENT_SOURCE_DIR}/3rdparty/xwax/lut.c"
+    "${CMAKE_CURRENT_SOURCE_DIR}/3rdparty/xwax/lut_cache.c"
     "${CMAKE_CURRENT_SOURCE_DIR}/3rdparty/xwax/lut_mk2.c"
     "${CMAKE_CURRENT_SOURCE_DIR}/3rdparty/xwax/pitch_kalman.c"
     "${CMAKE_CURRENT_SOURCE_DIR}/3rdparty/xwax/timecoder.c"